@@ -0,0 +1,201 @@
+// End-to-end latency benchmark of Parsec.eval, as the app sees it: channel,
+// codec and native evaluation included.
+//
+// Run it on the Linux desktop target through the driver, which writes the
+// report to build/parsec_eval_benchmark.json:
+//
+//   flutter drive -d linux \
+//     --driver=test_driver/integration_test.dart \
+//     --target=integration_test/eval_benchmark_test.dart \
+//     --dart-define=PARSEC_BENCH_ITERATIONS=1000 \
+//     --dart-define=PARSEC_BENCH_CONCURRENCY=64 \
+//     --dart-define=PARSEC_BENCH_WORKLOADS=single,burst,long
+
+import 'dart:math' as math;
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+import 'package:parsec/parsec.dart';
+
+const int _iterations = int.fromEnvironment('PARSEC_BENCH_ITERATIONS', defaultValue: 200);
+const int _concurrency = int.fromEnvironment('PARSEC_BENCH_CONCURRENCY', defaultValue: 32);
+const String _workloads =
+    String.fromEnvironment('PARSEC_BENCH_WORKLOADS', defaultValue: 'single,burst,long');
+
+/// Formulas from the README examples and the parsec test suite, by category.
+const Map<String, List<String>> _corpus = {
+  'arithmetic': [
+    '2 + 3',
+    '(5 + 1) + (6 - 2)',
+    '10.5 / 5.25',
+    '3^(3^(2))',
+    'sqrt(16) + cbrt(8)',
+    '2 + 3 * sin(pi/2)',
+  ],
+  'ternary': [
+    '4 > 2 ? "bigger" : "smaller"',
+    '2 == 2 ? true : false',
+    '(3==3) and (3!=3)',
+  ],
+  'string': [
+    'toupper("test string")',
+    'concat("Hello ", "World")',
+    'left("Hello World", 5)',
+  ],
+  'date': [
+    'daysdiff("2018-01-01", "2018-12-31")',
+    'hoursdiff("2019-02-01T08:20", "2019-02-01T12:00")',
+  ],
+  'variadic': [
+    'max(1, 2) + min(3, 4) + sum(5, 6)',
+    'avg(9, 9.8, 10)',
+  ],
+};
+
+/// Long formulas, to see how latency grows with the formula size.
+final Map<String, List<String>> _longCorpus = {
+  'long_sum': [
+    List.generate(100, (i) => '$i * 1.5').join(' + '),
+    'sum(${List.generate(250, (i) => '$i').join(', ')})',
+  ],
+  'long_nested': [
+    '${'(' * 50}1${' + 1)' * 50}',
+    '${List.generate(30, (i) => '$i > 15 ? $i : ').join()}0',
+  ],
+};
+
+/// Collects the latencies of one workload category.
+class _LatencyRecorder {
+  final List<int> _micros = [];
+  int errors = 0;
+  int elapsedMicros = 0;
+
+  void add(int micros) => _micros.add(micros);
+
+  int _percentile(List<int> sorted, double percentile) {
+    final rank = (percentile / 100 * sorted.length).ceil() - 1;
+    return sorted[rank.clamp(0, sorted.length - 1)];
+  }
+
+  /// Latency histogram with power of two bucket bounds, in microseconds.
+  List<Map<String, int>> _histogram() {
+    final counts = <int, int>{};
+    for (final micros in _micros) {
+      final bound = micros <= 1 ? 1 : 1 << (micros - 1).bitLength;
+      counts[bound] = (counts[bound] ?? 0) + 1;
+    }
+    final bounds = counts.keys.toList()..sort();
+    return [
+      for (final bound in bounds) {'upperBoundMicros': bound, 'count': counts[bound]!},
+    ];
+  }
+
+  Map<String, dynamic> toJson() {
+    final sorted = List.of(_micros)..sort();
+    final total = sorted.fold<int>(0, (sum, micros) => sum + micros);
+    return {
+      'count': sorted.length,
+      'errors': errors,
+      'throughputPerSecond':
+          elapsedMicros == 0 ? 0 : sorted.length * Duration.microsecondsPerSecond / elapsedMicros,
+      'latencyMicros': sorted.isEmpty
+          ? {}
+          : {
+              'min': sorted.first,
+              'mean': total / sorted.length,
+              'p50': _percentile(sorted, 50),
+              'p95': _percentile(sorted, 95),
+              'p99': _percentile(sorted, 99),
+              'max': sorted.last,
+            },
+      'histogram': _histogram(),
+    };
+  }
+}
+
+/// Evaluates [equation] and records its latency, counting evaluation errors.
+Future<void> _timedEval(Parsec parsec, String equation, _LatencyRecorder recorder) async {
+  final stopwatch = Stopwatch()..start();
+  try {
+    await parsec.eval(equation);
+  } on ParsecEvalException {
+    recorder.errors++;
+  }
+  recorder.add(stopwatch.elapsedMicroseconds);
+}
+
+/// Awaits every call before issuing the next one.
+Future<Map<String, dynamic>> _runSequential(
+    Parsec parsec, Map<String, List<String>> corpus) async {
+  final report = <String, dynamic>{};
+  for (final category in corpus.keys) {
+    final recorder = _LatencyRecorder();
+    final stopwatch = Stopwatch()..start();
+    for (var i = 0; i < _iterations; i++) {
+      for (final equation in corpus[category]!) {
+        await _timedEval(parsec, equation, recorder);
+      }
+    }
+    recorder.elapsedMicros = stopwatch.elapsedMicroseconds;
+    report[category] = recorder.toJson();
+  }
+  return report;
+}
+
+/// Issues bursts of [_concurrency] calls at once, the latency of each call
+/// including its wait behind the rest of the burst.
+Future<Map<String, dynamic>> _runBurst(Parsec parsec) async {
+  final report = <String, dynamic>{};
+  for (final category in _corpus.keys) {
+    final equations = _corpus[category]!;
+    final recorder = _LatencyRecorder();
+    final bursts = math.max(1, _iterations * equations.length ~/ _concurrency);
+    final stopwatch = Stopwatch()..start();
+    for (var burst = 0; burst < bursts; burst++) {
+      await Future.wait([
+        for (var i = 0; i < _concurrency; i++)
+          _timedEval(parsec, equations[i % equations.length], recorder),
+      ]);
+    }
+    recorder.elapsedMicros = stopwatch.elapsedMicroseconds;
+    report[category] = recorder.toJson();
+  }
+  return report;
+}
+
+void main() {
+  final binding = IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  testWidgets('benchmarks Parsec.eval latency', (WidgetTester tester) async {
+    final parsec = Parsec();
+    final workloads = _workloads.split(',').map((workload) => workload.trim()).toSet();
+    final results = <String, dynamic>{};
+
+    // Warm up the channel and the native formula cache.
+    for (final equations in _corpus.values) {
+      for (final equation in equations) {
+        await parsec.eval(equation);
+      }
+    }
+
+    if (workloads.contains('single')) {
+      results['single'] = await _runSequential(parsec, _corpus);
+    }
+    if (workloads.contains('burst')) {
+      results['burst'] = await _runBurst(parsec);
+    }
+    if (workloads.contains('long')) {
+      results['long'] = await _runSequential(parsec, _longCorpus);
+    }
+
+    binding.reportData = {
+      'platform': kIsWeb ? 'web' : defaultTargetPlatform.name,
+      'iterations': _iterations,
+      'concurrency': _concurrency,
+      'workloads': results,
+    };
+
+    expect(results, isNotEmpty);
+  });
+}
@@ -0,0 +1,81 @@
+// Tests of the Linux plugin against its native code, which the unit tests of
+// parsec_linux only mock. Run them on the Linux desktop target:
+//
+//   flutter test integration_test/linux_plugin_test.dart -d linux
+
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+import 'package:parsec/parsec.dart';
+
+void main() {
+  IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  final parsec = Parsec();
+  late Directory directory;
+
+  setUp(() async {
+    directory = await Directory.systemTemp.createTemp('parsec_linux_plugin_test');
+  });
+
+  tearDown(() async {
+    await directory.delete(recursive: true);
+  });
+
+  group('compile', () {
+    test('types numeric engine results as muparserx does', () async {
+      final formula = await parsec.compile('x * y + 1', ['x', 'y']);
+
+      expect(await formula.evaluate([2, 3]), isA<int>().having((value) => value, 'value', 7));
+      expect(await formula.evaluate([2.5, 2]), isA<double>().having((value) => value, 'value', 6));
+      await formula.dispose();
+    });
+  });
+
+  group('evalColumns', () {
+    test('returns the values eval gives for each row, out of domain ones included', () async {
+      final xs = [-1.0, 0.0, 4.0];
+      final result = await parsec.evalColumns('sqrt(x) + ln(x)', {'x': Float64List.fromList(xs)});
+
+      for (var row = 0; row < xs.length; row++) {
+        final expected = await parsec.eval('sqrt(${xs[row]}) + ln(${xs[row]})');
+        expect(result.hasError(row), isFalse);
+        if (expected is double && expected.isNaN) {
+          expect(result.values[row], isNaN);
+        } else {
+          expect(result.values[row], expected);
+        }
+      }
+    });
+  });
+
+  group('evalFile', () {
+    test('rejects an output naming the input, leaving the input intact', () async {
+      final input = File('${directory.path}/formulas.txt')..writeAsStringSync('1 + 1\n2 * 3\n');
+      final link = '${directory.path}/link.txt';
+      await Process.run('ln', [input.path, link]);
+
+      for (final output in [input.path, link]) {
+        await expectLater(
+          parsec.evalFile(input.path, output),
+          throwsA(isA<PlatformException>().having((error) => error.code, 'code', 'file_error')),
+        );
+      }
+      expect(input.readAsStringSync(), '1 + 1\n2 * 3\n');
+    });
+
+    test('leaves no partial output when the input cannot be read', () async {
+      final output = File('${directory.path}/results.jsonl')..writeAsStringSync('previous');
+
+      await expectLater(
+        parsec.evalFile('${directory.path}/missing.txt', output.path),
+        throwsA(isA<PlatformException>()),
+      );
+      expect(output.readAsStringSync(), 'previous');
+      expect(directory.listSync(), hasLength(1));
+    });
+  });
+}
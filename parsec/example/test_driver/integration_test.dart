@@ -0,0 +1,13 @@
+import 'package:integration_test/integration_test_driver.dart';
+
+// Writes the data reported by the integration tests to
+// build/parsec_eval_benchmark.json.
+Future<void> main() {
+  return integrationDriver(
+    responseDataCallback: (data) async {
+      if (data != null) {
+        await writeResponseData(data, testOutputFilename: 'parsec_eval_benchmark');
+      }
+    },
+  );
+}
@@ -5,10 +5,226 @@
 // platforms in the `pubspec.yaml` at
 // https://flutter.dev/docs/development/packages-and-plugins/developing-packages#plugin-platforms.
 
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart' show kIsWeb;
 import 'package:parsec_platform_interface/parsec_platform_interface.dart';
 
+import 'parsec_formula.dart';
+import 'parsec_isolate_pool_web.dart'
+    if (dart.library.io) 'parsec_isolate_pool.dart';
+import 'parsec_sheet.dart';
+
+export 'package:parsec_platform_interface/parsec_column_result.dart';
+export 'package:parsec_platform_interface/parsec_eval_exception.dart';
+export 'package:parsec_platform_interface/parsec_file_progress.dart';
+export 'parsec_formula.dart';
+export 'parsec_sheet.dart';
+
 class Parsec {
+  Parsec() : _pool = null;
+
+  Parsec._withPool(this._pool);
+
+  final ParsecIsolatePool? _pool;
+
+  /// Creates a [Parsec] sending its [eval] and [evalBatch] calls from a pool
+  /// of [size] background isolates, which also decode the results, instead of
+  /// from the calling isolate. Each call goes to the least busy isolate, and
+  /// batches are split across all of them. Must be called from the root
+  /// isolate; on the web, where there are no background isolates, the
+  /// returned [Parsec] evaluates as usual.
+  ///
+  /// ```dart
+  /// final parsec = await Parsec.withIsolatePool(size: 4);
+  /// await parsec.evalBatch(equations);
+  /// parsec.close();
+  /// ```
+  static Future<Parsec> withIsolatePool({int size = 2}) async {
+    if (kIsWeb) return Parsec();
+    return Parsec._withPool(await ParsecIsolatePool.spawn(size));
+  }
+
+  /// Kills the isolate pool, if any. Pooled calls still in flight, and any
+  /// made afterwards, fail with a [StateError].
+  void close() {
+    _pool?.close();
+  }
+
   Future<dynamic> eval(String equation) {
+    final pool = _pool;
+    if (pool != null) return pool.eval(equation);
     return ParsecPlatform.instance.nativeEval(equation);
   }
+
+  /// Evaluates [equation] synchronously, without a platform channel hop
+  /// (Linux, through dart:ffi). Throws a [ParsecEvalException] on errors.
+  dynamic evalSync(String equation) {
+    return ParsecPlatform.instance.nativeEvalSync(equation);
+  }
+
+  /// Evaluates all [equations] at once, returning one entry per equation in
+  /// input order. Equations that fail to evaluate yield a
+  /// [ParsecEvalException] in their slot instead of throwing.
+  Future<List<dynamic>> evalBatch(List<String> equations) {
+    final pool = _pool;
+    if (pool != null) return pool.evalBatch(equations);
+    return ParsecPlatform.instance.nativeEvalBatch(equations);
+  }
+
+  /// Evaluates the equations of [equations] as they arrive, emitting their
+  /// results in input order. Equations that fail to evaluate yield a
+  /// [ParsecEvalException] error event and the stream goes on.
+  ///
+  /// At most [maxInFlight] equations are sent for evaluation without their
+  /// result having come back; past that, and while the returned stream is
+  /// paused, [equations] is paused too.
+  ///
+  /// ```dart
+  /// parsec.evalStream(Stream.fromIterable(['1 + 1', '2 * 3'])).listen(print);
+  /// ```
+  Stream<dynamic> evalStream(Stream<String> equations, {int maxInFlight = 64}) {
+    return ParsecPlatform.instance
+        .nativeEvalStream(equations, maxInFlight: maxInFlight);
+  }
+
+  /// Evaluates [equation] once per row of [columns], a map from variable name
+  /// to a column of values, without formatting the rows into strings.
+  ///
+  /// ```dart
+  /// final result = await parsec.evalColumns('x * 2 + y', {
+  ///   'x': Float64List.fromList([1, 2, 3]),
+  ///   'y': Float64List.fromList([10, 20, 30]),
+  /// });
+  /// result.values; // => [12.0, 24.0, 36.0]
+  /// ```
+  Future<ParsecColumnResult> evalColumns(
+      String equation, Map<String, Float64List> columns) {
+    return ParsecPlatform.instance.nativeEvalColumns(equation, columns);
+  }
+
+  /// Evaluates every line of the file at [inputPath] as an equation and
+  /// writes one result record per line to the file at [outputPath], in
+  /// [format], without loading the equations into Dart (Linux).
+  ///
+  /// The records are written to a temporary file renamed over [outputPath]
+  /// once every equation is evaluated, so a failed call leaves [outputPath]
+  /// as it was. [outputPath] must not name [inputPath], even through another
+  /// link; such calls fail with a `file_error`.
+  ///
+  /// ```dart
+  /// final done = await parsec.evalFile('formulas.txt', 'results.jsonl',
+  ///     onProgress: (progress) => print(progress.fraction));
+  /// done.errors; // => equations that failed, each with an error record
+  /// ```
+  Future<ParsecFileProgress> evalFile(
+    String inputPath,
+    String outputPath, {
+    ParsecRecordFormat format = ParsecRecordFormat.json,
+    void Function(ParsecFileProgress progress)? onProgress,
+  }) {
+    return ParsecPlatform.instance.nativeEvalFile(inputPath, outputPath,
+        format: format, onProgress: onProgress);
+  }
+
+  /// Parses [formula] once, with [variableNames] as its variables, so it can
+  /// be evaluated many times without being parsed again.
+  ///
+  /// ```dart
+  /// final price = await parsec.compile('x * y + 1', ['x', 'y']);
+  /// await price.evaluate([2, 3]); // => 7
+  /// await price.dispose();
+  /// ```
+  Future<ParsecFormula> compile(String formula, List<String> variableNames) async {
+    final id = await ParsecPlatform.instance.nativeCompile(formula, variableNames);
+    return ParsecFormula(id, List.unmodifiable(variableNames));
+  }
+
+  /// Creates a sheet of named cells recalculated incrementally on the native
+  /// side (Linux).
+  ///
+  /// ```dart
+  /// final sheet = await parsec.createSheet();
+  /// await sheet.update(
+  ///   values: {'price': 2.5, 'qty': 4},
+  ///   formulas: {'total': 'price * qty'},
+  /// ); // => {price: 2.5, qty: 4, total: 10.0}
+  /// await sheet.update(values: {'qty': 6}); // => {qty: 6, total: 15.0}
+  /// await sheet.dispose();
+  /// ```
+  Future<ParsecSheet> createSheet() async {
+    return ParsecSheet(await ParsecPlatform.instance.nativeCreateSheet());
+  }
+
+  /// Starts loading the evaluation engine in the background, so the first
+  /// [eval] does not wait for it: on the web, fetching, compiling and
+  /// instantiating the WebAssembly module, whose compiled form is cached
+  /// across visits. Call it at app start without awaiting, or await it to
+  /// read the time each phase took, in milliseconds (`fetch`, `compile`,
+  /// `instantiate` and `firstEval` on the web, nothing on other platforms).
+  ///
+  /// ```dart
+  /// void main() {
+  ///   Parsec().warmUp();
+  ///   runApp(const MyApp());
+  /// }
+  /// ```
+  Future<Map<String, dynamic>> warmUp() {
+    return ParsecPlatform.instance.nativeWarmUp();
+  }
+
+  /// Sets how many parsed formulas the native formula cache keeps. Repeated
+  /// [eval] calls of a cached formula skip parsing. On Linux, each thread
+  /// splitting a large [evalBatch] keeps up to [capacity] formulas too. A
+  /// [capacity] of 0 disables the cache.
+  Future<void> setCacheCapacity(int capacity) {
+    return ParsecPlatform.instance.nativeSetCacheCapacity(capacity);
+  }
+
+  /// Returns the counters of the native formula cache (`hits`, `misses`,
+  /// `evictions`, `size` and `capacity`), to tune its capacity. On Linux, the
+  /// counters and size include the caches of the threads splitting large
+  /// batches and files.
+  Future<Map<String, int>> getCacheStats() {
+    return ParsecPlatform.instance.nativeGetCacheStats();
+  }
+
+  /// Returns the native evaluation counters (Linux): calls, errors, bytes in
+  /// and out, and the count, total and maximum time and a latency histogram of
+  /// the `parse`, `evaluate` and `serialize` phases, to tell which one is the
+  /// bottleneck. The counters are always on and cheap to keep enabled.
+  Future<Map<String, dynamic>> getStats() {
+    return ParsecPlatform.instance.nativeGetStats();
+  }
+
+  /// Sets every native evaluation counter back to zero (Linux).
+  Future<void> resetStats() {
+    return ParsecPlatform.instance.nativeResetStats();
+  }
+
+  /// Configures the native worker pool that evaluates equations off the
+  /// platform thread, so slow formulas do not stall rendering.
+  ///
+  /// [poolSize] is the number of worker threads, 0 evaluating on the platform
+  /// thread instead; on the web, it is the number of Web Workers, each with its
+  /// own WebAssembly module, and is 0 by default. Evaluations beyond
+  /// [maxQueueDepth] waiting for a worker fail with a `queue_full`
+  /// `PlatformException`; it must be at least 1, there is no unlimited queue.
+  /// [parallelism] is the number of threads splitting a single large
+  /// [evalBatch] or [evalColumns] call across cores, all of them by default and
+  /// 1 disabling the splitting; results keep the input order either way.
+  /// Omitted values are left unchanged. Returns the resulting configuration, or
+  /// throws an [ArgumentError] without changing anything if [poolSize] is
+  /// negative or [maxQueueDepth] or [parallelism] is below 1.
+  Future<Map<String, int>> configureWorkerPool({
+    int? poolSize,
+    int? maxQueueDepth,
+    int? parallelism,
+  }) {
+    return ParsecPlatform.instance.nativeConfigureWorkerPool(
+      poolSize: poolSize,
+      maxQueueDepth: maxQueueDepth,
+      parallelism: parallelism,
+    );
+  }
 }
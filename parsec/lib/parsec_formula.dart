@@ -0,0 +1,28 @@
+import 'package:parsec_platform_interface/parsec_platform_interface.dart';
+
+/// A formula parsed once on the native side and evaluated many times with
+/// different variable values, returned by `Parsec.compile`.
+///
+/// Call [dispose] once the formula is no longer needed to free its native
+/// resources.
+class ParsecFormula {
+  /// Native id of the compiled formula.
+  final int id;
+
+  /// Names of the formula variables, in the order [evaluate] expects values.
+  final List<String> variableNames;
+
+  ParsecFormula(this.id, this.variableNames);
+
+  /// Evaluates the formula with [values] bound to [variableNames], position by
+  /// position. Values may be numbers, booleans or strings.
+  Future<dynamic> evaluate(List<dynamic> values) {
+    return ParsecPlatform.instance.nativeEvaluate(id, values);
+  }
+
+  /// Frees the native resources of the formula. It cannot be evaluated
+  /// afterwards.
+  Future<void> dispose() {
+    return ParsecPlatform.instance.nativeDispose(id);
+  }
+}
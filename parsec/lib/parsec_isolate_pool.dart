@@ -0,0 +1,171 @@
+import 'dart:async';
+import 'dart:isolate';
+import 'dart:ui' show DartPluginRegistrant;
+
+import 'package:flutter/services.dart';
+import 'package:parsec_platform_interface/parsec_platform_interface.dart';
+
+import 'parsec_pool_dispatcher.dart';
+
+/// Background isolates evaluating equations through the platform channels,
+/// so sending the requests and decoding their results happens off the UI
+/// isolate.
+///
+/// Each request goes to the isolate with the fewest requests in flight, and
+/// large batches are split in slices across all of them. An isolate that dies
+/// fails its requests in flight with the error that killed it, and is left out
+/// of the next requests.
+class ParsecIsolatePool {
+  ParsecIsolatePool._(this._dispatcher);
+
+  final ParsecPoolDispatcher _dispatcher;
+
+  /// Spawns [size] background isolates bound to the platform channels of the
+  /// root isolate, which must be the calling one. Fails if any of them dies
+  /// before it is ready, killing the others.
+  static Future<ParsecIsolatePool> spawn(int size) async {
+    if (size < 1) {
+      throw ArgumentError.value(size, 'size', 'must be at least 1');
+    }
+
+    final token = RootIsolateToken.instance!;
+    final spawning = List.generate(size, (_) => _Worker.spawn(token));
+    try {
+      final workers = await Future.wait(spawning);
+      return ParsecIsolatePool._(ParsecPoolDispatcher(workers));
+    } catch (_) {
+      for (final worker in spawning) {
+        worker.then((worker) => worker.close(), onError: (_) {});
+      }
+      rethrow;
+    }
+  }
+
+  Future<dynamic> eval(String equation) => _dispatcher.eval(equation);
+
+  Future<List<dynamic>> evalBatch(List<String> equations) =>
+      _dispatcher.evalBatch(equations);
+
+  /// Kills the isolates. Requests still in flight fail with a [StateError].
+  void close() => _dispatcher.close();
+}
+
+class _Worker implements ParsecPoolWorker {
+  _Worker._(this._isolate, this._replies, this._errors, this._exits) {
+    _replies.listen(_onReply);
+    _errors.listen((message) {
+      final [error, stackTrace] = message as List<Object?>;
+      _fail(RemoteError('$error', '$stackTrace'));
+    });
+    _exits.listen((_) => _fail(StateError('Parsec isolate exited')));
+  }
+
+  final Isolate _isolate;
+  final ReceivePort _replies;
+  // Uncaught errors of the isolate, which kill it
+  final ReceivePort _errors;
+  final ReceivePort _exits;
+  final Completer<void> _ready = Completer();
+  late final SendPort _requests;
+  final Map<int, Completer<Object?>> _pending = {};
+  int _nextId = 0;
+  bool _closed = false;
+
+  @override
+  int get inFlight => _pending.length;
+
+  @override
+  bool get closed => _closed;
+
+  static Future<_Worker> spawn(RootIsolateToken token) async {
+    final replies = ReceivePort();
+    final errors = ReceivePort();
+    final exits = ReceivePort();
+    final Isolate isolate;
+    try {
+      isolate = await Isolate.spawn(_main, (token, replies.sendPort),
+          debugName: 'parsec',
+          onError: errors.sendPort,
+          onExit: exits.sendPort);
+    } catch (_) {
+      replies.close();
+      errors.close();
+      exits.close();
+      rethrow;
+    }
+    final worker = _Worker._(isolate, replies, errors, exits);
+    await worker._ready.future;
+    return worker;
+  }
+
+  @override
+  Future<Object?> run(ParsecPoolTask task) {
+    if (_closed) return Future.error(StateError('Isolate pool closed'));
+
+    final id = _nextId++;
+    final completer = Completer<Object?>();
+    _pending[id] = completer;
+    _requests.send((id, task));
+    return completer.future;
+  }
+
+  @override
+  void close() {
+    if (_closed) return;
+    _isolate.kill(priority: Isolate.immediate);
+    _fail(StateError('Isolate pool closed'));
+  }
+
+  // Fails the spawn if the isolate is not ready yet, and the requests in
+  // flight, and stops taking requests.
+  void _fail(Object error) {
+    if (_closed) return;
+    _closed = true;
+
+    _replies.close();
+    _errors.close();
+    _exits.close();
+    if (!_ready.isCompleted) _ready.completeError(error);
+    for (final completer in _pending.values) {
+      completer.completeError(error);
+    }
+    _pending.clear();
+  }
+
+  void _onReply(dynamic message) {
+    if (message is SendPort) {
+      // The first message of the isolate is the port taking its requests
+      _requests = message;
+      _ready.complete();
+      return;
+    }
+
+    final (id, result, error) = message as (int, Object?, Object?);
+    final completer = _pending.remove(id);
+    if (completer == null) return;
+
+    if (error != null) {
+      completer.completeError(error);
+    } else {
+      completer.complete(result);
+    }
+  }
+
+  static void _main((RootIsolateToken, SendPort) args) {
+    final (token, replies) = args;
+    BackgroundIsolateBinaryMessenger.ensureInitialized(token);
+    // Registers the platform implementations, as in the root isolate
+    DartPluginRegistrant.ensureInitialized();
+
+    final requests = ReceivePort();
+    replies.send(requests.sendPort);
+    requests.listen((message) async {
+      final (id, task) = message as (int, ParsecPoolTask);
+      try {
+        replies.send((id, await task(ParsecPlatform.instance), null));
+      } catch (error) {
+        replies.send((id, null, error));
+      }
+    });
+  }
+}
@@ -0,0 +1,14 @@
+/// Background isolates are not available on the web, where `Parsec` never
+/// spawns a pool.
+class ParsecIsolatePool {
+  static Future<ParsecIsolatePool> spawn(int size) {
+    throw UnsupportedError('Isolate pools are not supported on the web');
+  }
+
+  Future<dynamic> eval(String equation) => throw UnimplementedError();
+
+  Future<List<dynamic>> evalBatch(List<String> equations) =>
+      throw UnimplementedError();
+
+  void close() {}
+}
@@ -0,0 +1,78 @@
+import 'dart:async';
+import 'dart:math';
+
+import 'package:parsec_platform_interface/parsec_platform_interface.dart';
+
+/// A request run by a pool worker against the platform implementation of its
+/// isolate.
+typedef ParsecPoolTask = Future<Object?> Function(ParsecPlatform platform);
+
+/// A worker of a [ParsecPoolDispatcher].
+abstract class ParsecPoolWorker {
+  /// Requests sent to the worker that did not complete yet.
+  int get inFlight;
+
+  /// Whether the worker was closed or died. It then fails any new request.
+  bool get closed;
+
+  Future<Object?> run(ParsecPoolTask task);
+
+  void close();
+}
+
+/// Spreads requests over a fixed set of workers.
+///
+/// Each request goes to the open worker with the fewest requests in flight,
+/// round-robin among equally loaded ones, and large batches are split in
+/// contiguous slices across all of them, their results reassembled in input
+/// order.
+class ParsecPoolDispatcher {
+  ParsecPoolDispatcher(this._workers);
+
+  final List<ParsecPoolWorker> _workers;
+  int _next = 0;
+
+  Future<dynamic> eval(String equation) {
+    return _run((platform) => platform.nativeEval(equation));
+  }
+
+  Future<List<dynamic>> evalBatch(List<String> equations) async {
+    final open = _workers.where((worker) => !worker.closed).length;
+    final slices = min(open, equations.length);
+    if (slices <= 1) return _evalSlice(equations);
+
+    final sliceLength = (equations.length / slices).ceil();
+    final results = await Future.wait([
+      for (var start = 0; start < equations.length; start += sliceLength)
+        _evalSlice(equations.sublist(
+            start, min(start + sliceLength, equations.length))),
+    ]);
+    return [for (final slice in results) ...slice];
+  }
+
+  Future<List<dynamic>> _evalSlice(List<String> equations) async {
+    return await _run((platform) => platform.nativeEvalBatch(equations))
+        as List<dynamic>;
+  }
+
+  void close() {
+    for (final worker in _workers) {
+      worker.close();
+    }
+  }
+
+  Future<Object?> _run(ParsecPoolTask task) {
+    ParsecPoolWorker? chosen;
+    for (var i = 0; i < _workers.length; i++) {
+      final worker = _workers[(_next + i) % _workers.length];
+      if (worker.closed) continue;
+      if (chosen == null || worker.inFlight < chosen.inFlight) chosen = worker;
+    }
+    _next = (_next + 1) % _workers.length;
+
+    if (chosen == null) {
+      return Future.error(StateError('Isolate pool closed'));
+    }
+    return chosen.run(task);
+  }
+}
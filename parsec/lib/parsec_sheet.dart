@@ -0,0 +1,38 @@
+import 'package:parsec_platform_interface/parsec_platform_interface.dart';
+
+/// A native set of named cells, each holding a value or a formula over other
+/// cells, returned by `Parsec.createSheet`.
+///
+/// Cells reference each other by name. Updates only recalculate the cells
+/// below the changed ones and report the cells whose value changed, so their
+/// cost follows the size of the change rather than of the sheet.
+///
+/// Call [dispose] once the sheet is no longer needed to free its native
+/// resources.
+class ParsecSheet {
+  /// Native id of the sheet.
+  final int id;
+
+  ParsecSheet(this.id);
+
+  /// Changes the cells of the sheet: removes the cells named in [remove], then
+  /// sets [formulas] and [values], both keyed by cell name. Values may be
+  /// numbers, booleans or strings.
+  ///
+  /// Returns the cells whose value changed, mapped to their new value, or to
+  /// a [ParsecEvalException] for cells in error: invalid or circular formulas,
+  /// references to undefined cells, or evaluation errors.
+  Future<Map<String, dynamic>> update({
+    Map<String, String>? formulas,
+    Map<String, dynamic>? values,
+    List<String>? remove,
+  }) {
+    return ParsecPlatform.instance.nativeUpdateSheet(id,
+        formulas: formulas, values: values, remove: remove);
+  }
+
+  /// Frees the native resources of the sheet. It cannot be updated afterwards.
+  Future<void> dispose() {
+    return ParsecPlatform.instance.nativeDisposeSheet(id);
+  }
+}
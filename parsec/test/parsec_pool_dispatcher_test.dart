@@ -0,0 +1,115 @@
+import 'dart:async';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:parsec/parsec_pool_dispatcher.dart';
+import 'package:parsec_platform_interface/parsec_platform_interface.dart';
+
+/// Platform answering each equation with its own text, recording the batches
+/// it receives.
+class _EchoPlatform extends ParsecPlatform {
+  final List<List<String>> batches = [];
+
+  @override
+  Future<dynamic> nativeEval(String equation) async => equation;
+
+  @override
+  Future<List<dynamic>> nativeEvalBatch(List<String> equations) async {
+    batches.add(equations);
+    return equations;
+  }
+}
+
+/// Worker holding each request until [completeAll] is called.
+class _FakeWorker implements ParsecPoolWorker {
+  final _EchoPlatform platform = _EchoPlatform();
+  final List<(ParsecPoolTask, Completer<Object?>)> _held = [];
+  bool _closed = false;
+  int requests = 0;
+
+  @override
+  int get inFlight => _held.length;
+
+  @override
+  bool get closed => _closed;
+
+  @override
+  Future<Object?> run(ParsecPoolTask task) {
+    requests++;
+    final completer = Completer<Object?>();
+    _held.add((task, completer));
+    return completer.future;
+  }
+
+  Future<void> completeAll() async {
+    final held = List.of(_held);
+    _held.clear();
+    for (final (task, completer) in held) {
+      completer.complete(await task(platform));
+    }
+  }
+
+  @override
+  void close() {
+    _closed = true;
+  }
+}
+
+void main() {
+  group('ParsecPoolDispatcher', () {
+    test('splits a batch in contiguous slices and keeps the input order',
+        () async {
+      final workers = List.generate(3, (_) => _FakeWorker());
+      final dispatcher = ParsecPoolDispatcher(workers);
+      final equations = [for (var i = 0; i < 10; i++) '$i + 1'];
+
+      final results = dispatcher.evalBatch(equations);
+      // Complete the slices out of order
+      for (final worker in workers.reversed) {
+        await worker.completeAll();
+      }
+
+      expect(await results, equations);
+      expect(workers.map((worker) => worker.platform.batches), [
+        [equations.sublist(0, 4)],
+        [equations.sublist(4, 8)],
+        [equations.sublist(8, 10)],
+      ]);
+    });
+
+    test('sends each request to the least loaded worker', () async {
+      final workers = List.generate(3, (_) => _FakeWorker());
+      final dispatcher = ParsecPoolDispatcher(workers);
+
+      // One request each, round-robin while they are equally loaded
+      final first = [for (var i = 0; i < 3; i++) dispatcher.eval('$i')];
+      expect(workers.map((worker) => worker.requests), [1, 1, 1]);
+
+      // Worker 1 is the only idle one, while the round-robin is on worker 0
+      await workers[1].completeAll();
+      final next = dispatcher.eval('3');
+      expect(workers.map((worker) => worker.requests), [1, 2, 1]);
+
+      for (final worker in workers) {
+        await worker.completeAll();
+      }
+      expect(await Future.wait([...first, next]), ['0', '1', '2', '3']);
+    });
+
+    test('leaves closed workers out', () async {
+      final workers = List.generate(2, (_) => _FakeWorker());
+      final dispatcher = ParsecPoolDispatcher(workers);
+      workers[0].close();
+
+      final result = dispatcher.evalBatch(['1', '2', '3']);
+      final single = dispatcher.eval('4');
+      await workers[1].completeAll();
+
+      expect(await result, ['1', '2', '3']);
+      expect(await single, '4');
+      expect(workers[0].requests, 0);
+
+      workers[1].close();
+      expect(dispatcher.eval('5'), throwsStateError);
+    });
+  });
+}
@@ -13,8 +13,8 @@ void main() {
 
     setUpAll(() async {
       parsec = Parsec();
-      // Wait for WebAssembly initialization - critical for Web platform
-      await Future.delayed(const Duration(milliseconds: 500));
+      // Load WebAssembly before the first evaluation - critical for Web platform
+      await parsec.warmUp();
     });
 
     group('when initializing the parsec web library', () {
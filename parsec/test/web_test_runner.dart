@@ -1,4 +1,5 @@
 import 'package:flutter_test/flutter_test.dart';
+import 'package:parsec/parsec.dart';
 import '../test_config.dart';
 import 'parsec_test.dart' as parsec_tests;
 
@@ -10,7 +11,7 @@ void main() async {
   setUpAll(() async {
     TestWidgetsFlutterBinding.ensureInitialized();
     await ParsecWebTestConfig.initialize();
-    await Future.delayed(const Duration(milliseconds: 500));
+    await Parsec().warmUp();
   });
 
   setUp(() {
@@ -28,6 +28,10 @@ class ParsecAndroidPlugin: FlutterPlugin, MethodCallHandler {
         val parsecResult = nativeEvalJson(equation)
         result.success(parsecResult)
       }
+      "nativeEvalBatch" -> {
+        val equations = call.argument<List<String>>("equations") ?: return
+        result.success(equations.map { nativeEvalJson(it) })
+      }
       else -> result.notImplemented()
     }
   }
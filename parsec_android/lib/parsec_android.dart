@@ -20,4 +20,11 @@ class ParsecAndroid extends ParsecPlatform {
     return _channel.invokeMethod('nativeEval', {'equation': equation}).then(
         (result) => parseNativeEvalResult(result));
   }
+
+  @override
+  Future<List<dynamic>> nativeEvalBatch(List<String> equations) {
+    return _channel
+        .invokeListMethod<String>('nativeEvalBatch', {'equations': equations})
+        .then((results) => parseNativeEvalBatchResult(results ?? const []));
+  }
 }
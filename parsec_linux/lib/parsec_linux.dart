@@ -1,16 +1,221 @@
+import 'dart:typed_data';
+
 import 'package:flutter/services.dart';
+import 'package:parsec_platform_interface/parsec_eval_exception.dart';
 import 'package:parsec_platform_interface/parsec_platform_interface.dart';
 
+import 'parsec_linux_eval_stream.dart';
+import 'parsec_linux_ffi.dart';
+
 const MethodChannel _channel = MethodChannel('parsec_linux');
+const EventChannel _streamChannel = EventChannel('parsec_linux/eval_stream');
+
+// Results of every evaluation stream, each event naming the stream it belongs
+// to. Shared since the native side serves a single listener.
+final Stream<dynamic> _streamEvents = _streamChannel.receiveBroadcastStream();
+
+const EventChannel _fileChannel = EventChannel('parsec_linux/eval_file');
+
+// Progress of every file evaluation, each event naming the job it belongs to.
+final Stream<dynamic> _fileEvents = _fileChannel.receiveBroadcastStream();
+
+// Tags the progress events of nativeEvalFile() calls.
+int _nextFileJob = 1;
 
 class ParsecLinux extends ParsecPlatform {
+  /// Creates the Linux implementation.
+  ///
+  /// With [useFfi], [nativeEval] evaluates in-process through dart:ffi
+  /// instead of the method channel, on a short-lived isolate so a slow formula
+  /// does not block the calling one, which costs an isolate spawn per call.
+  /// [nativeEvalSync] always uses dart:ffi, on the calling isolate, for
+  /// microsecond latency on cheap formulas. The dart:ffi path does not go
+  /// through the formula cache of the channel path, so
+  /// [nativeSetCacheCapacity] and [nativeGetCacheStats] do not cover it.
+  ParsecLinux({this.useFfi = false});
+
+  final bool useFfi;
+
   static void registerWith() {
     ParsecPlatform.instance = ParsecLinux();
   }
 
   @override
   Future<dynamic> nativeEval(String equation) {
-    return _channel.invokeMethod('nativeEval', {'equation': equation}).then(
-        (result) => parseNativeEvalResult(result));
+    if (useFfi) {
+      return ParsecLinuxFfi.evalJsonInIsolate(equation)
+          .then(parseNativeEvalResult);
+    }
+
+    return _channel
+        .invokeMapMethod('nativeEval', {'equation': equation, 'typed': true})
+        .then((result) => parseNativeTypedResult(result!));
+  }
+
+  @override
+  dynamic nativeEvalSync(String equation) {
+    return parseNativeEvalResult(ParsecLinuxFfi.instance.evalJson(equation));
+  }
+
+  @override
+  Future<List<dynamic>> nativeEvalBatch(List<String> equations) {
+    return _channel
+        .invokeListMethod('nativeEvalBatch', {'equations': equations, 'typed': true})
+        .then((results) => parseNativeTypedBatchResult(results ?? const []));
+  }
+
+  @override
+  Stream<dynamic> nativeEvalStream(Stream<String> equations,
+      {int maxInFlight = 64}) {
+    return ParsecLinuxEvalStream(
+            _channel, _streamEvents, equations, maxInFlight)
+        .stream;
+  }
+
+  @override
+  Future<ParsecColumnResult> nativeEvalColumns(
+      String equation, Map<String, Float64List> columns) async {
+    try {
+      final result = await _channel.invokeMapMethod<String, dynamic>(
+          'nativeEvalColumns', {'equation': equation, 'columns': columns});
+      return ParsecColumnResult(result!['values'], result['errors']);
+    } on PlatformException catch (error) {
+      throw ParsecEvalException(error.message ?? error.code);
+    }
+  }
+
+  @override
+  Future<ParsecFileProgress> nativeEvalFile(
+    String inputPath,
+    String outputPath, {
+    ParsecRecordFormat format = ParsecRecordFormat.json,
+    void Function(ParsecFileProgress progress)? onProgress,
+  }) async {
+    final job = _nextFileJob++;
+    final progress = onProgress == null
+        ? null
+        : _fileEvents
+            .where((event) => event is Map && event['job'] == job)
+            .listen((event) => onProgress(ParsecFileProgress.fromMap(event)));
+
+    try {
+      final result = await _channel.invokeMapMethod('evalFile', {
+        'inputPath': inputPath,
+        'outputPath': outputPath,
+        'format': format.name,
+        'job': job,
+      });
+      return ParsecFileProgress.fromMap(result!);
+    } on PlatformException catch (error) {
+      throw ParsecEvalException(error.message ?? error.code);
+    } finally {
+      await progress?.cancel();
+    }
+  }
+
+  @override
+  Future<int> nativeCompile(String formula, List<String> variableNames) async {
+    try {
+      final id = await _channel.invokeMethod<int>(
+          'nativeCompile', {'formula': formula, 'variables': variableNames});
+      return id!;
+    } on PlatformException catch (error) {
+      throw ParsecEvalException(error.message ?? error.code);
+    }
+  }
+
+  @override
+  Future<dynamic> nativeEvaluate(int formulaId, List<dynamic> values) {
+    return _channel
+        .invokeMapMethod('nativeEvaluate', {'id': formulaId, 'values': values})
+        .then((result) => parseNativeTypedResult(result!));
+  }
+
+  @override
+  Future<void> nativeDispose(int formulaId) {
+    return _channel.invokeMethod('nativeDispose', {'id': formulaId});
+  }
+
+  @override
+  Future<int> nativeCreateSheet() {
+    return _channel.invokeMethod<int>('createSheet').then((id) => id!);
+  }
+
+  @override
+  Future<Map<String, dynamic>> nativeUpdateSheet(
+    int sheetId, {
+    Map<String, String>? formulas,
+    Map<String, dynamic>? values,
+    List<String>? remove,
+  }) async {
+    try {
+      final changes = await _channel.invokeMapMethod<String, dynamic>('updateSheet', {
+        'id': sheetId,
+        if (formulas != null) 'formulas': formulas,
+        if (values != null) 'values': values,
+        if (remove != null) 'remove': remove,
+      });
+      return changes!.map((name, result) {
+        try {
+          return MapEntry(name, parseNativeTypedResult(result));
+        } on ParsecEvalException catch (error) {
+          return MapEntry(name, error);
+        }
+      });
+    } on PlatformException catch (error) {
+      throw ParsecEvalException(error.message ?? error.code);
+    }
+  }
+
+  @override
+  Future<void> nativeDisposeSheet(int sheetId) {
+    return _channel.invokeMethod('disposeSheet', {'id': sheetId});
+  }
+
+  @override
+  Future<void> nativeSetCacheCapacity(int capacity) {
+    return _channel.invokeMethod('setCacheCapacity', {'capacity': capacity});
+  }
+
+  @override
+  Future<Map<String, int>> nativeGetCacheStats() {
+    return _channel
+        .invokeMapMethod<String, int>('getCacheStats')
+        .then((stats) => stats ?? const {});
+  }
+
+  @override
+  Future<Map<String, dynamic>> nativeGetStats() {
+    return _channel
+        .invokeMapMethod<String, dynamic>('getStats')
+        .then((stats) => stats ?? const {});
+  }
+
+  @override
+  Future<void> nativeResetStats() {
+    return _channel.invokeMethod('resetStats');
+  }
+
+  @override
+  Future<Map<String, int>> nativeConfigureWorkerPool({
+    int? poolSize,
+    int? maxQueueDepth,
+    int? parallelism,
+  }) async {
+    if (poolSize != null && poolSize < 0) {
+      throw ArgumentError.value(poolSize, 'poolSize', 'must not be negative');
+    }
+    if (maxQueueDepth != null && maxQueueDepth < 1) {
+      throw ArgumentError.value(maxQueueDepth, 'maxQueueDepth', 'must be positive');
+    }
+    if (parallelism != null && parallelism < 1) {
+      throw ArgumentError.value(parallelism, 'parallelism', 'must be positive');
+    }
+
+    return _channel.invokeMapMethod<String, int>('configureWorkerPool', {
+      if (poolSize != null) 'poolSize': poolSize,
+      if (maxQueueDepth != null) 'maxQueueDepth': maxQueueDepth,
+      if (parallelism != null) 'parallelism': parallelism,
+    }).then((config) => config ?? const {});
   }
 }
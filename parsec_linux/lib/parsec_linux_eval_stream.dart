@@ -0,0 +1,170 @@
+import 'dart:async';
+import 'dart:math';
+
+import 'package:flutter/services.dart';
+import 'package:parsec_platform_interface/parsec_eval_exception.dart';
+
+/// Feeds a stream of equations to a native evaluation stream and emits
+/// their results in input order.
+///
+/// At most [maxInFlight] equations are sent without their result having come
+/// back; past that, the equations stream is paused until results arrive. It is
+/// also paused while the results stream is, so neither a fast producer nor a
+/// slow consumer lets native memory grow without limit. Equations arriving in
+/// the same event loop turn are sent in a single push.
+class ParsecLinuxEvalStream {
+  ParsecLinuxEvalStream(
+      this._channel, this._events, this._equations, this._maxInFlight);
+
+  final MethodChannel _channel;
+  final Stream<dynamic> _events;
+  final Stream<String> _equations;
+  final int _maxInFlight;
+
+  late final StreamController<dynamic> _results = StreamController(
+    onListen: _start,
+    onPause: _updateInput,
+    onResume: _resumeOutput,
+    onCancel: _stop,
+  );
+
+  StreamSubscription<String>? _input;
+  StreamSubscription<dynamic>? _output;
+  final List<String> _queued = [];
+  int? _id;
+  int _inFlight = 0;
+  bool _inputPaused = false;
+  bool _inputDone = false;
+  bool _flushScheduled = false;
+  bool _stopped = false;
+
+  /// Results of the equations in input order: the value of each equation, or
+  /// a [ParsecEvalException] error event for those that fail to evaluate.
+  Stream<dynamic> get stream => _results.stream;
+
+  Future<void> _start() async {
+    // Listen before opening, so no event of the stream can be missed
+    _output = _events.listen(_onEvent, onError: _fail);
+
+    try {
+      _id = await _channel
+          .invokeMethod<int>('openEvalStream', {'maxInFlight': _maxInFlight});
+    } on PlatformException catch (error) {
+      _fail(ParsecEvalException(error.message ?? error.code));
+      return;
+    }
+
+    if (_stopped) {
+      // Cancelled while opening
+      await _channel.invokeMethod('closeEvalStream', {'id': _id});
+      return;
+    }
+
+    _input = _equations.listen(_onEquation,
+        onError: _results.addError, onDone: _onInputDone);
+    _updateInput();
+  }
+
+  void _onEquation(String equation) {
+    _queued.add(equation);
+    _updateInput();
+    _scheduleFlush();
+  }
+
+  void _onInputDone() {
+    _inputDone = true;
+    _closeIfDone();
+  }
+
+  void _onEvent(dynamic event) {
+    if (event is! Map || event['id'] != _id || _stopped) return;
+
+    final results = event['results'] as List;
+    _inFlight -= results.length;
+    for (final result in results) {
+      final error = result['error'];
+      if (error != null) {
+        _results.addError(ParsecEvalException(error));
+      } else {
+        _results.add(result['val']);
+      }
+    }
+
+    _updateInput();
+    _scheduleFlush();
+    _closeIfDone();
+  }
+
+  void _resumeOutput() {
+    _updateInput();
+    _scheduleFlush();
+  }
+
+  /// Pauses the equations stream while the credits are used up or the
+  /// results stream is paused, and resumes it otherwise.
+  void _updateInput() {
+    final input = _input;
+    if (input == null) return;
+
+    final pause =
+        _results.isPaused || _inFlight + _queued.length >= _maxInFlight;
+    if (pause && !_inputPaused) {
+      input.pause();
+    } else if (!pause && _inputPaused) {
+      input.resume();
+    }
+    _inputPaused = pause;
+  }
+
+  void _scheduleFlush() {
+    if (_flushScheduled) return;
+    _flushScheduled = true;
+    scheduleMicrotask(_flush);
+  }
+
+  void _flush() {
+    _flushScheduled = false;
+    if (_stopped || _results.isPaused || _queued.isEmpty) return;
+
+    final count = min(_queued.length, _maxInFlight - _inFlight);
+    if (count <= 0) return;
+
+    final equations = _queued.sublist(0, count);
+    _queued.removeRange(0, count);
+    _inFlight += count;
+
+    _channel.invokeMethod('pushEvalStream', {
+      'id': _id,
+      'equations': equations,
+    }).catchError((Object error) {
+      _fail(error is PlatformException
+          ? ParsecEvalException(error.message ?? error.code)
+          : error);
+    });
+  }
+
+  void _closeIfDone() {
+    if (_inputDone && _queued.isEmpty && _inFlight == 0 && !_stopped) {
+      _stop();
+      _results.close();
+    }
+  }
+
+  void _fail(Object error) {
+    if (_stopped) return;
+    _results.addError(error);
+    _stop();
+    _results.close();
+  }
+
+  Future<void> _stop() async {
+    if (_stopped) return;
+    _stopped = true;
+
+    await _input?.cancel();
+    await _output?.cancel();
+    if (_id != null) {
+      await _channel.invokeMethod('closeEvalStream', {'id': _id});
+    }
+  }
+}
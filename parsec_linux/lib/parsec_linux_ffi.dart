@@ -0,0 +1,79 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:isolate';
+
+import 'package:ffi/ffi.dart';
+
+typedef _EvalJsonNative = Pointer<Utf8> Function(
+    Pointer<Uint8> formula, Size formulaLength, Pointer<Size> resultLength);
+typedef _EvalJson = Pointer<Utf8> Function(
+    Pointer<Uint8> formula, int formulaLength, Pointer<Size> resultLength);
+
+/// Bindings to the C ABI exported by the `parsec_linux_plugin` library.
+///
+/// Evaluates formulas in-process and synchronously, without the method
+/// channel, with the same semantics and JSON result as the channel path.
+/// Formulas are evaluated with CalcJson, without the formula cache of the
+/// channel path.
+class ParsecLinuxFfi {
+  static const String libraryName = 'libparsec_linux_plugin.so';
+
+  static ParsecLinuxFfi? _instance;
+
+  /// Bindings to the plugin library loaded in the running application.
+  static ParsecLinuxFfi get instance =>
+      _instance ??= ParsecLinuxFfi(DynamicLibrary.open(libraryName));
+
+  final _EvalJson _evalJson;
+  final Pointer<Size> _resultLength = malloc<Size>();
+  Pointer<Uint8> _formula = nullptr;
+  int _formulaCapacity = 0;
+
+  ParsecLinuxFfi(DynamicLibrary library)
+      // Not a leaf call: a slow formula would hold up the garbage collection
+      // of every isolate until it returns.
+      : _evalJson = library.lookupFunction<_EvalJsonNative, _EvalJson>(
+            'parsec_eval_json');
+
+  /// Evaluates [equation] on a new isolate, so a slow formula does not block
+  /// the calling one, and returns its raw JSON result. The isolate binds the
+  /// library on its own and frees its buffers before exiting.
+  static Future<String> evalJsonInIsolate(String equation) {
+    return Isolate.run(() {
+      final bindings = ParsecLinuxFfi(DynamicLibrary.open(libraryName));
+      try {
+        return bindings.evalJson(equation);
+      } finally {
+        bindings.dispose();
+      }
+    });
+  }
+
+  /// Evaluates [equation] and returns its raw JSON result.
+  String evalJson(String equation) {
+    final bytes = utf8.encode(equation);
+    _reserve(bytes.length);
+    _formula.asTypedList(bytes.length).setAll(0, bytes);
+
+    final result = _evalJson(_formula, bytes.length, _resultLength);
+    return result.toDartString(length: _resultLength.value);
+  }
+
+  /// Frees the native buffers. The bindings cannot be used afterwards.
+  void dispose() {
+    malloc.free(_resultLength);
+    if (_formula != nullptr) malloc.free(_formula);
+    _formula = nullptr;
+    _formulaCapacity = 0;
+  }
+
+  // Reuses one native buffer for the formula text instead of allocating one
+  // per call.
+  void _reserve(int length) {
+    if (length <= _formulaCapacity) return;
+
+    if (_formula != nullptr) malloc.free(_formula);
+    _formulaCapacity = length * 2;
+    _formula = malloc<Uint8>(_formulaCapacity);
+  }
+}
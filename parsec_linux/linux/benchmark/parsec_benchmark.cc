@@ -0,0 +1,482 @@
+// Headless benchmark of the equations-parser core, independent from Flutter.
+//
+// Every formula of the corpus is measured in separate phases:
+//   setup      constructing a muparserx parser with all the non-complex packages
+//   pooled     acquiring a parser from the parser pool and releasing it, which replaces setup
+//              wherever the plugin needs a parser
+//   parse      tokenizing the formula and building its RPN (muparserx builds the RPN while it reads
+//              the tokens, so both happen in a single pass that cannot be timed apart)
+//   evaluate   running the RPN of an already parsed formula
+//   calc_json  CalcJson end to end, as the plugin runs it for every JSON result
+//   miss       evaluating through a formula cache that keeps nothing, as for a formula evaluated
+//              for the first time with a typed result: compiling it on a pooled parser and
+//              evaluating it
+//   cached     evaluating through the plugin formula cache, as for typed results
+//
+// Template formulas over variables are measured as compiled formulas instead:
+//   compiled   evaluating the formula as written
+//   optimized  evaluating the formula rewritten by the optimizer
+//   numeric    evaluating the formula on the numeric engine, for the purely numeric ones
+// and, for the purely numeric ones, evaluated over columns of kColumnRows rows, per row:
+//   rows       evaluating the rows one at a time on the numeric engine
+//   scalar     running each instruction over blocks of rows, without vector instructions
+//   sse2/avx2  running each instruction over blocks of rows with vector instructions, for the
+//              instruction sets the CPU supports
+// and, for all of them, over kParallelRows rows split across the threads of the parallel executor,
+// per row:
+//   serial     evaluating the columns on the calling thread
+//   parallel   evaluating the columns with --threads threads, all the cores by default
+//
+// Usage: parsec_benchmark [--iterations N] [--filter TEXT] [--threads N]
+// Exits with a non-zero status if a corpus formula fails to evaluate, if an optimized template
+// formula or the numeric engine gives a different type, value or error than muparserx for the
+// formula as written, or if a block executor disagrees with the row by row results.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "equationsParser.h"
+#include "mpParser.h"
+#include "parsec_compiled_formula.h"
+#include "parsec_formula_cache.h"
+#include "parsec_numeric_kernels.h"
+#include "parsec_numeric_program.h"
+#include "parsec_parallel.h"
+#include "parsec_parser_pool.h"
+
+using namespace std;
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+void* CountedAllocate(size_t size) {
+  allocations.fetch_add(1, memory_order_relaxed);
+  if (void *pointer = malloc(size == 0 ? 1 : size)) return pointer;
+  throw bad_alloc();
+}
+
+}  // namespace
+
+// Every heap allocation of the process goes through these, muparserx included, so the number of
+// allocations of a phase is the counter difference around it.
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void* operator new(size_t size, const nothrow_t&) noexcept {
+  try { return CountedAllocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+  try { return CountedAllocate(size); } catch (...) { return nullptr; }
+}
+void operator delete(void *pointer) noexcept { free(pointer); }
+void operator delete[](void *pointer) noexcept { free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { free(pointer); }
+
+namespace {
+
+struct CorpusEntry {
+  const char *category;
+  const char *formula;
+};
+
+// Formulas from the README examples and the parsec test suite.
+const CorpusEntry kCorpus[] = {
+  {"arithmetic", "2 + 3"},
+  {"arithmetic", "(5 + 1) + (6 - 2)"},
+  {"arithmetic", "4 + 4 * 3"},
+  {"arithmetic", "10.5 / 5.25"},
+  {"arithmetic", "((2 + 3) * 4) - 1"},
+  {"arithmetic", "(3^3)^2"},
+  {"arithmetic", "3^(3^(2))"},
+  {"arithmetic", "10!"},
+  {"arithmetic", "5*5 + 5!"},
+  {"arithmetic", "sqrt(16) + cbrt(8)"},
+  {"arithmetic", "log10(10) + ln(e) + log(10)"},
+  {"arithmetic", "sin(1) + cos(0) + tan(0.15722)"},
+  {"arithmetic", "2 + 3 * sin(pi/2)"},
+  {"arithmetic", "round_decimal(4.559, 2)"},
+  {"arithmetic", "5 / 0"},
+  {"ternary", "4 > 2 ? \"bigger\" : \"smaller\""},
+  {"ternary", "2 == 2 ? true : false"},
+  {"ternary", "\"this\" != \"that\" ? \"yes\" : \"no\""},
+  {"ternary", "(3==3) and (3!=3)"},
+  {"ternary", "exp(1) == e"},
+  {"string", "string(10)"},
+  {"string", "length(\"test string\")"},
+  {"string", "toupper(\"test string\")"},
+  {"string", "concat(\"Hello \", \"World\")"},
+  {"string", "link(\"Title\", \"http://foo.bar\")"},
+  {"string", "str2number(\"5\")"},
+  {"string", "left(\"Hello World\", 5)"},
+  {"date", "daysdiff(\"2018-01-01\", \"2018-12-31\")"},
+  {"date", "hoursdiff(\"2019-02-01T08:20\", \"2019-02-01T12:00\")"},
+  {"variadic", "max(1, 2) + min(3, 4) + sum(5, 6)"},
+  {"variadic", "avg(9, 9.8, 10)"},
+  {"variadic", "sum(1, 2, 3, 4, 5, 6, 7, 8, 9, 10)"},
+};
+
+// Formulas as generated by templates, over the variables x and y.
+const CorpusEntry kTemplateCorpus[] = {
+  {"template", "pi/180 * x + pi/180 * y"},
+  {"template", "pow(2, 10) * x + round_decimal(0.1*3, 2) * y"},
+  {"template", "(x+y)*sin(x+y)/(x+y)"},
+  {"template", "sin(x*2) * sin(x*2) + sin(x*2) * cos(y)"},
+  {"template", "x > y ? sqrt(x*x + y*y) * 1 : 0"},
+  {"template", "x * length(concat(\"ab\", \"cd\")) + y"},
+  {"template", "x * y + 1"},
+  {"template", "x > y ? x - y : 2 * y"},
+  {"template", "sqrt(x - y) + ln(x) / (y - 1)"},
+  {"template", "(x * y) / 1 + (x - y) ^ 1"},
+  {"template", "(x * y) * 1.0 + 1 * (x - y) * 1 - 0"},
+};
+
+// Rows of the columns template formulas are evaluated over.
+constexpr size_t kColumnRows = 4096;
+// Rows of the columns split across threads.
+constexpr size_t kParallelRows = 1 << 18;
+
+struct Measure {
+  double ns_per_op;
+  double allocations_per_op;
+};
+
+/**
+ * @brief Runs @p operation @p iterations times and returns its mean time and allocation count.
+ */
+template <typename Operation>
+Measure Run(int iterations, Operation &&operation) {
+  // Warm up caches and lazily initialized state before measuring.
+  operation();
+
+  uint64_t allocations_before = allocations.load(memory_order_relaxed);
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    operation();
+  }
+  auto elapsed = chrono::steady_clock::now() - start;
+  uint64_t allocated = allocations.load(memory_order_relaxed) - allocations_before;
+
+  Measure measure;
+  measure.ns_per_op = (double) chrono::duration_cast<chrono::nanoseconds>(elapsed).count() / iterations;
+  measure.allocations_per_op = (double) allocated / iterations;
+  return measure;
+}
+
+void PrintRow(const CorpusEntry &entry, const char *phase, const Measure &measure) {
+  printf("%-10s  %-48.48s  %-9s  %12.1f  %10.2f\n", entry.category, entry.formula, phase,
+         measure.ns_per_op, measure.allocations_per_op);
+}
+
+/**
+ * @brief Measures every phase of @p entry. Returns false if the formula fails to evaluate.
+ */
+bool Benchmark(const CorpusEntry &entry, int iterations) {
+  string formula = entry.formula;
+  try {
+    PrintRow(entry, "setup", Run(iterations, [] {
+      mup::ParserX parser(mup::pckALL_NON_COMPLEX);
+    }));
+
+    PrintRow(entry, "pooled", Run(iterations, [] {
+      parsec_linux::GlobalParserPool().Acquire();
+    }));
+
+    mup::ParserX parser(mup::pckALL_NON_COMPLEX);
+    PrintRow(entry, "parse", Run(iterations, [&] {
+      parser.SetExpr(formula);
+      parser.GetExprVar();
+    }));
+
+    PrintRow(entry, "evaluate", Run(iterations, [&] { parser.Eval(); }));
+  } catch (mup::ParserError &error) {
+    fprintf(stderr, "%s: %s\n", entry.formula, error.GetMsg().c_str());
+    return false;
+  }
+
+  PrintRow(entry, "calc_json", Run(iterations, [&] { EquationsParser::CalcJson(formula); }));
+
+  // The type of the result, as the typed channel path reads it before converting the value.
+  auto type = [](const mup::IValue &value) { return value.GetType(); };
+  auto error = [](const string &) { return 'e'; };
+
+  parsec_linux::FormulaCache uncached(0);
+  PrintRow(entry, "miss", Run(iterations, [&] {
+    parsec_linux::EvalCached(uncached, formula, type, error);
+  }));
+
+  parsec_linux::FormulaCache cache;
+  PrintRow(entry, "cached", Run(iterations, [&] {
+    parsec_linux::EvalCached(cache, formula, type, error);
+  }));
+  return true;
+}
+
+// Whether two results are the same value of the same type, NaN being the same as NaN.
+bool SameValue(const mup::IValue &a, const mup::IValue &b) {
+  if (a.GetType() != b.GetType()) return false;
+  switch (a.GetType()) {
+    case 'f':
+      return a.GetFloat() == b.GetFloat() || (isnan(a.GetFloat()) && isnan(b.GetFloat()));
+    case 'i':
+      return a.GetInteger() == b.GetInteger();
+    case 'b':
+      return a.GetBool() == b.GetBool();
+    default:
+      return a.ToString() == b.ToString();
+  }
+}
+
+/**
+ * @brief Checks that @p optimized gives the results of @p compiled, which muparserx evaluates as
+ * written, with integer, float and mixed variables: the same type and value, or an error for both.
+ * Returns false if they differ.
+ */
+bool SameResults(const CorpusEntry &entry, parsec_linux::CompiledFormula &compiled,
+                 parsec_linux::CompiledFormula &optimized) {
+  const mup::Value bindings[][2] = {
+      {mup::Value(mup::int_type(2)), mup::Value(mup::int_type(3))},
+      {mup::Value(mup::int_type(-4)), mup::Value(mup::int_type(0))},
+      {mup::Value(1.25), mup::Value(0.5)},
+      {mup::Value(mup::int_type(2)), mup::Value(0.5)},
+      {mup::Value(2.0), mup::Value(mup::int_type(1))},
+  };
+
+  bool same = true;
+  for (const auto &binding : bindings) {
+    mup::Value expected, actual;
+    bool expected_failed = false, actual_failed = false;
+    for (parsec_linux::CompiledFormula *formula : {&compiled, &optimized}) {
+      formula->variable(0) = binding[0];
+      formula->variable(1) = binding[1];
+      bool &failed = formula == &compiled ? expected_failed : actual_failed;
+      try {
+        (formula == &compiled ? expected : actual) = mup::Value(formula->Evaluate());
+      } catch (mup::ParserError &) {
+        failed = true;
+      }
+    }
+
+    if (expected_failed != actual_failed ||
+        (!expected_failed && !SameValue(expected, actual))) {
+      fprintf(stderr, "%s: with x = %s, y = %s, optimized result %s (%c) instead of %s (%c)\n",
+              entry.formula, binding[0].ToString().c_str(), binding[1].ToString().c_str(),
+              actual_failed ? "error" : actual.ToString().c_str(), actual.GetType(),
+              expected_failed ? "error" : expected.ToString().c_str(), expected.GetType());
+      same = false;
+    }
+  }
+  return same;
+}
+
+/**
+ * @brief Measures @p entry compiled as written and optimized, on the numeric engine if it is purely
+ * numeric. Returns false if it fails to evaluate, or if the optimized formula gives different
+ * results.
+ */
+bool BenchmarkCompiled(const CorpusEntry &entry, int iterations) {
+  const vector<string> variable_names = {"x", "y"};
+  try {
+    parsec_linux::CompiledFormula compiled(entry.formula, variable_names);
+    parsec_linux::CompiledFormula optimized(entry.formula, variable_names, true);
+    if (!SameResults(entry, compiled, optimized)) return false;
+
+    for (parsec_linux::CompiledFormula *formula : {&compiled, &optimized}) {
+      formula->variable(0) = 1.25;
+      formula->variable(1) = 0.5;
+    }
+
+    PrintRow(entry, "compiled", Run(iterations, [&] { compiled.Evaluate(); }));
+    PrintRow(entry, optimized.numeric() ? "numeric" : "optimized",
+             Run(iterations, [&] { optimized.Evaluate(); }));
+
+    const parsec_linux::OptimizerStats &stats = optimized.optimizer_stats();
+    if (stats.nodes_before > 0) {
+      printf("%-10s  %-48.48s  %-9s  %zu -> %zu RPN nodes\n", entry.category, entry.formula,
+             "optimizer", stats.nodes_before, stats.nodes_after);
+    }
+  } catch (mup::ParserError &error) {
+    fprintf(stderr, "%s: %s\n", entry.formula, error.GetMsg().c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Measures the numeric program of @p entry over columns, row by row and with each block
+ * executor. Returns false if the block executors disagree with the row by row results, or if
+ * those differ from the values and errors muparserx gives for the same rows.
+ */
+bool BenchmarkColumns(const CorpusEntry &entry, int iterations) {
+  unique_ptr<parsec_linux::NumericProgram> program =
+      parsec_linux::NumericProgram::Compile(entry.formula, {"x", "y"});
+  if (program == nullptr) return true;
+
+  vector<double> x(kColumnRows), y(kColumnRows);
+  for (size_t row = 0; row < kColumnRows; row++) {
+    x[row] = (double) row / kColumnRows;
+    y[row] = 1.0 - (double) (row % 97) / 97;
+  }
+  const double *columns[] = {x.data(), y.data()};
+
+  vector<double> expected(kColumnRows);
+  auto per_row = [](Measure measure) {
+    measure.ns_per_op /= kColumnRows;
+    measure.allocations_per_op /= kColumnRows;
+    return measure;
+  };
+  PrintRow(entry, "rows", per_row(Run(iterations, [&] {
+    for (size_t row = 0; row < kColumnRows; row++) {
+      program->variable(0) = x[row];
+      program->variable(1) = y[row];
+      expected[row] = program->Run();
+    }
+  })));
+
+  bool identical = true;
+  try {
+    // The formula as written, evaluated by muparserx row by row.
+    parsec_linux::CompiledFormula reference(entry.formula, {"x", "y"});
+    vector<double> values(kColumnRows);
+    vector<uint8_t> errors((kColumnRows + 7) / 8);
+    reference.EvaluateColumns(columns, kColumnRows, values.data(), errors.data());
+    for (size_t row = 0; row < kColumnRows && identical; row++) {
+      bool failed = (errors[row / 8] >> (row % 8)) & 1;
+      bool same = values[row] == expected[row] || (isnan(values[row]) && isnan(expected[row]));
+      if (failed || !same) {
+        fprintf(stderr, "%s: with x = %g, y = %g, numeric engine result %g instead of %s\n",
+                entry.formula, x[row], y[row], expected[row],
+                failed ? "an error" : to_string(values[row]).c_str());
+        identical = false;
+      }
+    }
+  } catch (mup::ParserError &error) {
+    fprintf(stderr, "%s: %s\n", entry.formula, error.GetMsg().c_str());
+    return false;
+  }
+
+  int detected = static_cast<int>(parsec_linux::DetectSimdLevel());
+  for (int level = 0; level <= detected; level++) {
+    vector<double> out(kColumnRows);
+    PrintRow(entry, parsec_linux::SimdLevelName(static_cast<parsec_linux::SimdLevel>(level)),
+             per_row(Run(iterations, [&] {
+               program->RunColumns(columns, kColumnRows, out.data(), level);
+             })));
+    if (memcmp(out.data(), expected.data(), kColumnRows * sizeof(double)) != 0) {
+      fprintf(stderr, "%s: %s results differ\n", entry.formula,
+              parsec_linux::SimdLevelName(static_cast<parsec_linux::SimdLevel>(level)));
+      identical = false;
+    }
+  }
+  return identical;
+}
+
+/**
+ * @brief Measures @p entry over large columns on one thread and split across @p executor. Returns
+ * false if it fails to compile or the results differ.
+ */
+bool BenchmarkParallel(const CorpusEntry &entry, int iterations,
+                       parsec_linux::ParallelExecutor &executor) {
+  vector<double> x(kParallelRows), y(kParallelRows);
+  for (size_t row = 0; row < kParallelRows; row++) {
+    x[row] = (double) row / kParallelRows;
+    y[row] = 1.0 - (double) (row % 97) / 97;
+  }
+  const double *columns[] = {x.data(), y.data()};
+  size_t bitmap_bytes = (kParallelRows + 7) / 8;
+  vector<double> serial(kParallelRows), parallel(kParallelRows);
+  vector<uint8_t> serial_errors(bitmap_bytes), parallel_errors(bitmap_bytes);
+
+  try {
+    parsec_linux::CompiledFormula formula(entry.formula, {"x", "y"}, true);
+    auto per_row = [](Measure measure) {
+      measure.ns_per_op /= kParallelRows;
+      measure.allocations_per_op /= kParallelRows;
+      return measure;
+    };
+    PrintRow(entry, "serial", per_row(Run(iterations, [&] {
+      fill(serial_errors.begin(), serial_errors.end(), 0);
+      formula.EvaluateColumns(columns, kParallelRows, serial.data(), serial_errors.data());
+    })));
+    PrintRow(entry, "parallel", per_row(Run(iterations, [&] {
+      fill(parallel_errors.begin(), parallel_errors.end(), 0);
+      parsec_linux::EvaluateColumnsParallel(executor, formula, columns, kParallelRows,
+                                            parallel.data(), parallel_errors.data());
+    })));
+  } catch (mup::ParserError &error) {
+    fprintf(stderr, "%s: %s\n", entry.formula, error.GetMsg().c_str());
+    return false;
+  }
+
+  // NaN rows compare by bits, the same way they were computed.
+  if (memcmp(serial.data(), parallel.data(), kParallelRows * sizeof(double)) != 0 ||
+      serial_errors != parallel_errors) {
+    fprintf(stderr, "%s: parallel results differ\n", entry.formula);
+    return false;
+  }
+  return true;
+}
+
+bool Matches(const CorpusEntry &entry, const char *filter) {
+  return filter == nullptr || strstr(entry.formula, filter) != nullptr ||
+         strcmp(entry.category, filter) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int iterations = 10000;
+  const char *filter = nullptr;
+  size_t threads = max(1u, thread::hardware_concurrency());
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = max(1, atoi(argv[++i]));
+    } else {
+      fprintf(stderr, "Usage: %s [--iterations N] [--filter TEXT] [--threads N]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (iterations <= 0) iterations = 1;
+
+  printf("%zu threads for the parallel phase\n", threads);
+  printf("%-10s  %-48s  %-9s  %12s  %10s\n", "category", "formula", "phase", "ns/op", "allocs/op");
+
+  int failures = 0;
+  for (const CorpusEntry &entry : kCorpus) {
+    if (Matches(entry, filter) && !Benchmark(entry, iterations)) failures++;
+  }
+  for (const CorpusEntry &entry : kTemplateCorpus) {
+    if (Matches(entry, filter) && !BenchmarkCompiled(entry, iterations)) failures++;
+  }
+  // Each iteration evaluates kColumnRows rows.
+  int column_iterations = max(1, iterations / 100);
+  for (const CorpusEntry &entry : kTemplateCorpus) {
+    if (Matches(entry, filter) && !BenchmarkColumns(entry, column_iterations)) failures++;
+  }
+  // Each iteration evaluates kParallelRows rows.
+  parsec_linux::ParallelExecutor executor(threads);
+  int parallel_iterations = max(1, iterations / 1000);
+  for (const CorpusEntry &entry : kTemplateCorpus) {
+    if (Matches(entry, filter) && !BenchmarkParallel(entry, parallel_iterations, executor)) {
+      failures++;
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+#ifndef FLUTTER_PLUGIN_PARSEC_LINUX_FFI_H_
+#define FLUTTER_PLUGIN_PARSEC_LINUX_FFI_H_
+
+#include <stddef.h>
+
+#ifdef FLUTTER_PLUGIN_IMPL
+#define FLUTTER_PLUGIN_EXPORT __attribute__((visibility("default")))
+#else
+#define FLUTTER_PLUGIN_EXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Stable C ABI to evaluate formulas in-process, without the method channel, for dart:ffi callers.
+ *
+ * @formula: the UTF-8 formula text, not necessarily NUL-terminated
+ * @formula_length: the length of @formula in bytes
+ * @result_length: where to store the length of the result in bytes, may be NULL
+ *
+ * Evaluates @formula with CalcJson, so the result is the CalcJson text, without the method channel
+ * and without going through the formula cache of the plugin instances. Safe to call from any
+ * thread.
+ *
+ * Returns: the NUL-terminated JSON result. It is owned by the library and stays valid until the
+ * next call of parsec_eval_json on the same thread.
+ */
+FLUTTER_PLUGIN_EXPORT const char* parsec_eval_json(const char* formula, size_t formula_length,
+                                                   size_t* result_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FLUTTER_PLUGIN_PARSEC_LINUX_FFI_H_
@@ -0,0 +1,211 @@
+#include "parsec_compiled_formula.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace mup;
+
+namespace parsec_linux {
+
+struct CompiledFormula::OptimizedParsers {
+  struct Subexpression {
+    string name;
+    // Value slot the later subexpressions and the formula read it from.
+    Value value;
+    PooledParser parser = GlobalParserPool().Acquire();
+  };
+
+  // In evaluation order.
+  vector<unique_ptr<Subexpression>> subexpressions;
+  PooledParser parser = GlobalParserPool().Acquire();
+};
+
+CompiledFormula::CompiledFormula(const string &formula)
+    : formula_(formula),
+      parser_(GlobalParserPool().Acquire()) {
+  parser_->SetExpr(formula_);
+}
+
+CompiledFormula::CompiledFormula(const string &formula, const vector<string> &variable_names,
+                                 bool optimize)
+    : formula_(formula),
+      variable_names_(variable_names),
+      values_(new Value[variable_names.size()]),
+      parser_(GlobalParserPool().Acquire()) {
+  for (size_t i = 0; i < variable_names_.size(); i++) {
+    parser_->DefineVar(variable_names_[i], Variable(&values_[i]));
+  }
+  parser_->SetExpr(formula_);
+
+  // Querying the used variables builds the RPN right away, so syntax errors surface at compile
+  // time and every later Eval() runs straight from the RPN.
+  const var_maptype &used_variables = parser_->GetExprVar();
+  for (const auto &used : used_variables) {
+    if (find(variable_names_.begin(), variable_names_.end(), used.first) == variable_names_.end()) {
+      throw ParserError("Undefined variable: " + used.first);
+    }
+  }
+  parsed_ = true;
+
+  if (optimize) Optimize();
+}
+
+CompiledFormula::~CompiledFormula() = default;
+
+void CompiledFormula::Optimize() {
+  numeric_ = NumericProgram::Compile(formula_, variable_names_);
+  if (numeric_ != nullptr) return;
+
+  OptimizedFormula optimized = OptimizeFormula(formula_, variable_names_);
+  if (!optimized.optimized) return;
+
+  auto parsers = make_unique<OptimizedParsers>();
+  auto define_variables = [this, &parsers](ParserX &parser) {
+    for (size_t i = 0; i < variable_names_.size(); i++) {
+      parser.DefineVar(variable_names_[i], Variable(&values_[i]));
+    }
+    for (const auto &subexpression : parsers->subexpressions) {
+      parser.DefineVar(subexpression->name, Variable(&subexpression->value));
+    }
+  };
+
+  try {
+    for (const auto &named : optimized.subexpressions) {
+      auto subexpression = make_unique<OptimizedParsers::Subexpression>();
+      subexpression->name = named.first;
+      define_variables(*subexpression->parser);
+      subexpression->parser->SetExpr(named.second);
+      subexpression->parser->GetExprVar();
+      parsers->subexpressions.push_back(std::move(subexpression));
+    }
+    define_variables(*parsers->parser);
+    parsers->parser->SetExpr(optimized.formula);
+    parsers->parser->GetExprVar();
+  } catch (ParserError &) {
+    // Keep evaluating the formula as written.
+    return;
+  }
+
+  optimized_ = std::move(parsers);
+  optimizer_stats_ = optimized.stats;
+}
+
+bool CompiledFormula::BindNumeric(bool *returns_int) {
+  if (!numeric_->result_type_known()) return false;
+
+  for (size_t i = 0; i < variable_names_.size(); i++) {
+    char type = values_[i].GetType();
+    if (type != 'f' && type != 'i') return false;
+    numeric_->variable(i) = values_[i].GetFloat();
+  }
+
+  *returns_int = numeric_->may_return_int();
+  for (uint32_t i : numeric_->int_variables()) {
+    if (values_[i].GetType() != 'i') *returns_int = false;
+  }
+  return true;
+}
+
+const IValue &CompiledFormula::Evaluate() {
+  bool returns_int = false;
+  if (numeric_ != nullptr && BindNumeric(&returns_int)) {
+    double result = numeric_->Run();
+    if (numeric_->returns_bool()) {
+      numeric_result_ = Value(result != 0);
+    } else if (returns_int && result >= numeric_limits<int_type>::min() &&
+               result <= numeric_limits<int_type>::max()) {
+      numeric_result_ = Value(static_cast<int_type>(result));
+    } else {
+      numeric_result_ = Value(result);
+    }
+    return numeric_result_;
+  }
+  if (optimized_ == nullptr) return parser_->Eval();
+
+  try {
+    for (const auto &subexpression : optimized_->subexpressions) {
+      subexpression->value = Value(subexpression->parser->Eval());
+    }
+    return optimized_->parser->Eval();
+  } catch (ParserError &) {
+    // Evaluate the formula as written, to report its error rather than one of the optimized
+    // formula, which refers to positions the user never wrote.
+    return parser_->Eval();
+  }
+}
+
+void CompiledFormula::Parse() {
+  if (parsed_) return;
+
+  // Querying the used variables builds the RPN, tolerating undefined variables.
+  if (!parser_->GetExprVar().empty()) {
+    // Let Eval() parse again and report the undefined variable.
+    parser_->SetExpr(formula_);
+  }
+  parsed_ = true;
+}
+
+size_t CompiledFormula::EvaluateColumns(const double *const *columns, size_t rows, double *out,
+                                        uint8_t *error_bitmap) {
+  if (numeric_ != nullptr) {
+    // The columns hold numbers, so every row runs on the vectorized numeric engine. muparserx
+    // returns NaN or infinities rather than errors for the operations it runs, so no row is
+    // flagged either way.
+    numeric_->RunColumns(columns, rows, out);
+    return 0;
+  }
+
+  size_t errors = 0;
+  for (size_t row = 0; row < rows; row++) {
+    for (size_t i = 0; i < variable_names_.size(); i++) {
+      values_[i] = columns[i][row];
+    }
+
+    bool failed = false;
+    try {
+      const IValue &value = Evaluate();
+      switch (value.GetType()) {
+        case 'i':
+        case 'f':
+          out[row] = value.GetFloat();
+          break;
+        case 'b':
+          out[row] = value.GetBool() ? 1.0 : 0.0;
+          break;
+        default:
+          failed = true;
+      }
+    } catch (ParserError &) {
+      failed = true;
+    }
+
+    if (failed) {
+      out[row] = NAN;
+      error_bitmap[row / 8] |= (uint8_t) (1u << (row % 8));
+      errors++;
+    }
+  }
+  return errors;
+}
+
+int64_t FormulaRegistry::Add(shared_ptr<CompiledFormula> formula) {
+  lock_guard<mutex> lock(mutex_);
+  int64_t id = next_id_++;
+  formulas_[id] = std::move(formula);
+  return id;
+}
+
+shared_ptr<CompiledFormula> FormulaRegistry::Find(int64_t id) const {
+  lock_guard<mutex> lock(mutex_);
+  auto it = formulas_.find(id);
+  return it == formulas_.end() ? nullptr : it->second;
+}
+
+bool FormulaRegistry::Remove(int64_t id) {
+  lock_guard<mutex> lock(mutex_);
+  return formulas_.erase(id) > 0;
+}
+
+}  // namespace parsec_linux
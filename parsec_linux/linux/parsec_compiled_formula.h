@@ -0,0 +1,180 @@
+#ifndef PARSEC_LINUX_PARSEC_COMPILED_FORMULA_H_
+#define PARSEC_LINUX_PARSEC_COMPILED_FORMULA_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mpParser.h"
+#include "parsec_numeric_program.h"
+#include "parsec_optimizer.h"
+#include "parsec_parser_pool.h"
+
+namespace parsec_linux {
+
+/**
+ * @brief A formula parsed once and evaluated many times with different variable values.
+ *
+ * The muparserx parser keeps the RPN built at compile time, so evaluations only bind the new
+ * variable values and run the RPN: tokenizing and RPN construction are out of the hot loop.
+ */
+class CompiledFormula {
+ public:
+  /**
+   * @brief Sets up @p formula without variables, as CalcJson evaluates it.
+   *
+   * Parsing is deferred to the first evaluation, so an invalid formula reports the same error from
+   * Evaluate() that CalcJson would.
+   */
+  explicit CompiledFormula(const std::string &formula);
+
+  /**
+   * @brief Parses @p formula, binding each name of @p variable_names to a value slot.
+   *
+   * With @p optimize, the formula is also prepared for being evaluated many times: it is lowered
+   * to a NumericProgram when it is purely numeric, and otherwise rewritten by OptimizeFormula().
+   * Evaluations run the fastest of them that applies to the variable values. The formula as
+   * written is kept to report errors, so evaluation errors stay the same.
+   *
+   * @throws mup::ParserError if the formula is invalid or references a variable that is not
+   * listed in @p variable_names.
+   */
+  CompiledFormula(const std::string &formula, const std::vector<std::string> &variable_names,
+                  bool optimize = false);
+
+  ~CompiledFormula();
+
+  // Disallow copy and assign: the parser holds pointers to the value slots.
+  CompiledFormula(const CompiledFormula&) = delete;
+  CompiledFormula& operator=(const CompiledFormula&) = delete;
+
+  const std::string &formula() const { return formula_; }
+
+  const std::vector<std::string> &variable_names() const { return variable_names_; }
+
+  /**
+   * @brief Whether the RPN of the formula is built, so Evaluate() only runs it.
+   */
+  bool parsed() const { return parsed_; }
+
+  /**
+   * @brief Tokenizes the formula and builds its RPN ahead of the first evaluation.
+   *
+   * A formula using variables it does not define is left for Evaluate() to report, so the error
+   * stays the one CalcJson gives.
+   *
+   * @throws mup::ParserError if the formula is invalid.
+   */
+  void Parse();
+
+  /**
+   * @brief Mutex to hold while binding values, evaluating and reading the result, since the
+   * parser keeps per-evaluation state and may be shared between worker threads.
+   */
+  std::mutex &mutex() { return mutex_; }
+
+  /**
+   * @brief Value slot of the variable at @p index, in the order given at compile time.
+   */
+  mup::Value &variable(size_t index) { return values_[index]; }
+
+  /**
+   * @brief What the optimizer did to the formula, all zeros if it was not optimized.
+   */
+  const OptimizerStats &optimizer_stats() const { return optimizer_stats_; }
+
+  /**
+   * @brief Whether the formula runs on the numeric engine when all its variables hold numbers.
+   */
+  bool numeric() const { return numeric_ != nullptr; }
+
+  /**
+   * @brief Evaluates the formula with the current variable values.
+   *
+   * @throws mup::ParserError on evaluation errors.
+   */
+  const mup::IValue &Evaluate();
+
+  /**
+   * @brief Evaluates the formula once per row of numeric columns.
+   *
+   * @p columns holds one array of @p rows doubles per variable, in the order given at compile
+   * time. The numeric result of each row is written to @p out; booleans are written as 1 or 0.
+   * Rows that fail to evaluate or produce a non-numeric value are written as NaN and flagged in
+   * @p error_bitmap, one bit per row (bit `row % 8` of byte `row / 8`), which must be zeroed and
+   * hold at least `(rows + 7) / 8` bytes.
+   *
+   * Reentrant for a numeric() formula, which does not need the mutex(); other formulas share their
+   * muparserx parser between the rows.
+   *
+   * @return the number of rows that failed.
+   */
+  size_t EvaluateColumns(const double *const *columns, size_t rows, double *out,
+                         uint8_t *error_bitmap);
+
+ private:
+  struct OptimizedParsers;
+
+  void Optimize();
+
+  /**
+   * @brief Binds the variable values to the numeric program, and sets @p returns_int to whether
+   * muparserx would type the result as an integer with them. Returns false, leaving the formula
+   * to muparserx, if one of them is not a number or if the type of the result depends on more
+   * than the types of the variables.
+   */
+  bool BindNumeric(bool *returns_int);
+
+  std::string formula_;
+  std::vector<std::string> variable_names_;
+  // Heap array so the slot addresses registered in the parser never move.
+  std::unique_ptr<mup::Value[]> values_;
+  // Parser of the formula as written.
+  PooledParser parser_;
+  // Parsers of the optimized formula, or nullptr when it is not optimized.
+  std::unique_ptr<OptimizedParsers> optimized_;
+  OptimizerStats optimizer_stats_;
+  // Numeric engine program of the formula, or nullptr when it is not purely numeric.
+  std::unique_ptr<NumericProgram> numeric_;
+  // Result of the last evaluation on the numeric engine.
+  mup::Value numeric_result_;
+  std::mutex mutex_;
+  bool parsed_ = false;
+};
+
+/**
+ * @brief Owns the compiled formulas of a plugin instance and hands out integer ids for them.
+ *
+ * All methods are thread-safe.
+ */
+class FormulaRegistry {
+ public:
+  /**
+   * @brief Takes ownership of @p formula and returns the id it can be looked up with.
+   */
+  int64_t Add(std::shared_ptr<CompiledFormula> formula);
+
+  /**
+   * @brief Returns the formula registered under @p id, or nullptr if there is none.
+   *
+   * The formula stays alive while the returned pointer is held, even if it is removed meanwhile.
+   */
+  std::shared_ptr<CompiledFormula> Find(int64_t id) const;
+
+  /**
+   * @brief Frees the formula registered under @p id. Returns false if there was none.
+   */
+  bool Remove(int64_t id);
+
+ private:
+  mutable std::mutex mutex_;
+  std::unordered_map<int64_t, std::shared_ptr<CompiledFormula>> formulas_;
+  int64_t next_id_ = 1;
+};
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_COMPILED_FORMULA_H_
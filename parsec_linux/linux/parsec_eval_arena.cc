@@ -0,0 +1,63 @@
+#include "parsec_eval_arena.h"
+
+#include <cstdint>
+
+#include "parsec_eval_stats.h"
+
+using namespace std;
+
+namespace parsec_linux {
+
+EvalArena::~EvalArena() {
+  ReleaseOversized();
+  GlobalEvalStats().RecordArenaRelease(chunks_.size(), reserved_);
+}
+
+void *EvalArena::Allocate(size_t bytes, size_t alignment) {
+  if (bytes > kChunkBytes) return AllocateOversized(bytes);
+
+  // Chunks are filled in order; one too small for the request is skipped until the scope ends.
+  for (; position_.chunk < chunks_.size(); position_ = {position_.chunk + 1, 0}) {
+    Chunk &chunk = chunks_[position_.chunk];
+    uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data.get());
+    size_t offset = ((base + position_.offset + alignment - 1) & ~(alignment - 1)) - base;
+    if (offset + bytes <= chunk.size) {
+      position_.offset = offset + bytes;
+      return chunk.data.get() + offset;
+    }
+  }
+
+  // operator new[] memory is aligned for any fundamental type.
+  chunks_.push_back(Chunk{unique_ptr<char[]>(new char[kChunkBytes]), kChunkBytes});
+  reserved_ += kChunkBytes;
+  GlobalEvalStats().RecordArenaChunk(kChunkBytes);
+
+  position_ = {chunks_.size() - 1, bytes};
+  return chunks_.back().data.get();
+}
+
+void *EvalArena::AllocateOversized(size_t bytes) {
+  oversized_.push_back(Chunk{unique_ptr<char[]>(new char[bytes]), bytes});
+  reserved_ += bytes;
+  EvalStats &stats = GlobalEvalStats();
+  stats.RecordArenaOversized();
+  stats.RecordArenaChunk(bytes);
+  return oversized_.back().data.get();
+}
+
+void EvalArena::ReleaseOversized() {
+  size_t bytes = 0;
+  for (const Chunk &chunk : oversized_) {
+    bytes += chunk.size;
+  }
+  if (bytes > 0) GlobalEvalStats().RecordArenaRelease(oversized_.size(), bytes);
+  reserved_ -= bytes;
+  oversized_.clear();
+}
+
+EvalArena &ThreadEvalArena() {
+  static thread_local EvalArena arena;
+  return arena;
+}
+
+}  // namespace parsec_linux
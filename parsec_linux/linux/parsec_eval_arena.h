@@ -0,0 +1,121 @@
+#ifndef PARSEC_LINUX_PARSEC_EVAL_ARENA_H_
+#define PARSEC_LINUX_PARSEC_EVAL_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace parsec_linux {
+
+/**
+ * @brief Bump allocator for the temporaries of an evaluation.
+ *
+ * Allocating moves a cursor forward in the current chunk and freeing does nothing: everything
+ * allocated within an EvalArenaScope is released in bulk when the scope ends. Chunks are kept for
+ * the next evaluations, so once the arena has grown to the needs of the workload, evaluations
+ * allocate their temporaries without any heap traffic. A request larger than kChunkBytes gets a
+ * chunk of its own instead, returned to the heap when the outermost scope ends, so a single huge
+ * evaluation does not pin its memory to the thread for good.
+ *
+ * Not thread-safe: each thread uses its own arena, ThreadEvalArena().
+ */
+class EvalArena {
+ public:
+  static constexpr size_t kChunkBytes = 64 * 1024;
+
+  EvalArena() = default;
+  ~EvalArena();
+
+  // Disallow copy and assign: allocations point into the chunks.
+  EvalArena(const EvalArena&) = delete;
+  EvalArena& operator=(const EvalArena&) = delete;
+
+  void *Allocate(size_t bytes, size_t alignment);
+
+  /**
+   * @brief Bytes reserved from the heap by the chunks currently held.
+   */
+  size_t reserved() const { return reserved_; }
+
+ private:
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  struct Position {
+    size_t chunk;
+    size_t offset;
+  };
+
+  void *AllocateOversized(size_t bytes);
+  void ReleaseOversized();
+
+  std::vector<Chunk> chunks_;
+  Position position_{0, 0};
+  // Chunks of the requests larger than kChunkBytes, held until the outermost scope ends.
+  std::vector<Chunk> oversized_;
+  size_t reserved_ = 0;
+  // Scopes in progress.
+  size_t depth_ = 0;
+
+  friend class EvalArenaScope;
+};
+
+/**
+ * @brief The arena of the calling thread.
+ */
+EvalArena &ThreadEvalArena();
+
+/**
+ * @brief Releases everything allocated from the thread arena during its lifetime when destroyed.
+ *
+ * Scopes nest: an inner scope only releases what was allocated since it started, and the chunks of
+ * oversized requests are only freed when the outermost scope ends.
+ */
+class EvalArenaScope {
+ public:
+  EvalArenaScope() : arena_(ThreadEvalArena()), start_(arena_.position_) { arena_.depth_++; }
+  ~EvalArenaScope() {
+    arena_.position_ = start_;
+    if (--arena_.depth_ == 0) arena_.ReleaseOversized();
+  }
+
+  EvalArenaScope(const EvalArenaScope&) = delete;
+  EvalArenaScope& operator=(const EvalArenaScope&) = delete;
+
+ private:
+  EvalArena &arena_;
+  EvalArena::Position start_;
+};
+
+/**
+ * @brief Standard allocator drawing from the thread arena, for containers of temporaries that do
+ * not outlive the enclosing EvalArenaScope.
+ */
+template <typename T>
+struct ArenaAllocator {
+  using value_type = T;
+
+  ArenaAllocator() = default;
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>&) {}
+
+  T *allocate(size_t count) {
+    return static_cast<T*>(ThreadEvalArena().Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>&) const { return true; }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_EVAL_ARENA_H_
@@ -0,0 +1,98 @@
+#include "parsec_eval_stats.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace parsec_linux {
+
+namespace {
+
+size_t LatencyBucket(uint64_t elapsed_ns) {
+  if (elapsed_ns == 0) return 0;
+  size_t bucket = 64 - __builtin_clzll(elapsed_ns);
+  return bucket < kLatencyBuckets ? bucket : kLatencyBuckets - 1;
+}
+
+}  // namespace
+
+void EvalStats::RecordPhase(EvalPhase phase, uint64_t elapsed_ns) {
+  PhaseCounters &counters = ThreadShard().phases[static_cast<size_t>(phase)];
+  Add(counters.count, 1);
+  Add(counters.total_ns, elapsed_ns);
+  Add(counters.histogram[LatencyBucket(elapsed_ns)], 1);
+
+  // Only the threads sharing the shard compete for its maximum, so this rarely loops.
+  uint64_t max_ns = counters.max_ns.load(memory_order_relaxed);
+  while (elapsed_ns > max_ns &&
+         !counters.max_ns.compare_exchange_weak(max_ns, elapsed_ns, memory_order_relaxed)) {
+  }
+}
+
+EvalStats::Shard &EvalStats::ThreadShard() {
+  // Indexes the shards of every EvalStats the same way, as there is only GlobalEvalStats().
+  static thread_local size_t index = next_shard_.fetch_add(1, memory_order_relaxed) % kShards;
+  return shards_[index];
+}
+
+EvalStatsSnapshot EvalStats::Snapshot() const {
+  EvalStatsSnapshot snapshot;
+  for (const Shard &shard : shards_) {
+    snapshot.calls += shard.calls.load(memory_order_relaxed);
+    snapshot.errors += shard.errors.load(memory_order_relaxed);
+    snapshot.bytes_in += shard.bytes_in.load(memory_order_relaxed);
+    snapshot.bytes_out += shard.bytes_out.load(memory_order_relaxed);
+    snapshot.optimized_formulas += shard.optimized_formulas.load(memory_order_relaxed);
+    snapshot.nodes_removed += shard.nodes_removed.load(memory_order_relaxed);
+    snapshot.numeric_formulas += shard.numeric_formulas.load(memory_order_relaxed);
+    snapshot.arena_chunks += shard.arena_chunks.load(memory_order_relaxed);
+    snapshot.arena_bytes += shard.arena_bytes.load(memory_order_relaxed);
+    snapshot.arena_oversized += shard.arena_oversized.load(memory_order_relaxed);
+    for (size_t i = 0; i < kEvalPhaseCount; i++) {
+      const PhaseCounters &counters = shard.phases[i];
+      EvalPhaseStats &stats = snapshot.phases[i];
+      stats.count += counters.count.load(memory_order_relaxed);
+      stats.total_ns += counters.total_ns.load(memory_order_relaxed);
+      stats.max_ns = max(stats.max_ns, counters.max_ns.load(memory_order_relaxed));
+      for (size_t bucket = 0; bucket < kLatencyBuckets; bucket++) {
+        stats.histogram[bucket] += counters.histogram[bucket].load(memory_order_relaxed);
+      }
+    }
+  }
+  return snapshot;
+}
+
+void EvalStats::Reset() {
+  for (Shard &shard : shards_) {
+    shard.calls.store(0, memory_order_relaxed);
+    shard.errors.store(0, memory_order_relaxed);
+    shard.bytes_in.store(0, memory_order_relaxed);
+    shard.bytes_out.store(0, memory_order_relaxed);
+    shard.optimized_formulas.store(0, memory_order_relaxed);
+    shard.nodes_removed.store(0, memory_order_relaxed);
+    shard.numeric_formulas.store(0, memory_order_relaxed);
+    // The arena chunks and bytes are what the arenas hold, not a count since the last reset.
+    shard.arena_oversized.store(0, memory_order_relaxed);
+    for (PhaseCounters &counters : shard.phases) {
+      counters.count.store(0, memory_order_relaxed);
+      counters.total_ns.store(0, memory_order_relaxed);
+      counters.max_ns.store(0, memory_order_relaxed);
+      for (atomic<uint64_t> &bucket : counters.histogram) {
+        bucket.store(0, memory_order_relaxed);
+      }
+    }
+  }
+}
+
+EvalStats &GlobalEvalStats() {
+  static EvalStats stats;
+  return stats;
+}
+
+uint64_t MonotonicNanos() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace parsec_linux
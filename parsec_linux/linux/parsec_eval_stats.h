@@ -0,0 +1,157 @@
+#ifndef PARSEC_LINUX_PARSEC_EVAL_STATS_H_
+#define PARSEC_LINUX_PARSEC_EVAL_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace parsec_linux {
+
+/**
+ * @brief The timed phases of an evaluation.
+ */
+enum class EvalPhase {
+  // Setting up the parser, tokenizing the formula and building its RPN.
+  kParse,
+  // Running the RPN.
+  kEvaluate,
+  // Converting the result to JSON or to a codec value.
+  kSerialize,
+};
+
+constexpr size_t kEvalPhaseCount = 3;
+
+/**
+ * @brief Number of latency histogram buckets. Bucket 0 counts 0 ns, bucket i counts latencies in
+ * [2^(i-1), 2^i) ns and the last bucket everything slower.
+ */
+constexpr size_t kLatencyBuckets = 40;
+
+struct EvalPhaseStats {
+  uint64_t count = 0;
+  uint64_t total_ns = 0;
+  uint64_t max_ns = 0;
+  std::array<uint64_t, kLatencyBuckets> histogram{};
+};
+
+struct EvalStatsSnapshot {
+  uint64_t calls = 0;
+  uint64_t errors = 0;
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  // Formulas rewritten by the optimizer, and RPN nodes it removed from them.
+  uint64_t optimized_formulas = 0;
+  uint64_t nodes_removed = 0;
+  // Formulas lowered to the numeric engine.
+  uint64_t numeric_formulas = 0;
+  // Chunks the evaluation arenas hold from the heap right now, and their bytes. Steady once the
+  // arenas fit the workload, and left as they are by Reset().
+  uint64_t arena_chunks = 0;
+  uint64_t arena_bytes = 0;
+  // Requests too large for an arena chunk, which got a chunk of their own freed after the call.
+  uint64_t arena_oversized = 0;
+  std::array<EvalPhaseStats, kEvalPhaseCount> phases;
+};
+
+/**
+ * @brief Process-wide evaluation counters.
+ *
+ * Every counter is a relaxed atomic, so recording never takes a lock and stays cheap enough to be
+ * always enabled. Counters are kept in kShards shards, each on cache lines of its own, and a thread
+ * always records into the same shard, so threads evaluating at once do not bounce the lines of a
+ * shared counter between their cores. Snapshot() sums the shards.
+ *
+ * A snapshot taken while evaluations run is not atomic as a whole: counters of different fields
+ * may be off by the evaluations in flight.
+ */
+class EvalStats {
+ public:
+  static constexpr size_t kShards = 16;
+
+  void RecordCall(size_t bytes_in) {
+    Shard &shard = ThreadShard();
+    Add(shard.calls, 1);
+    Add(shard.bytes_in, bytes_in);
+  }
+
+  void RecordError() { Add(ThreadShard().errors, 1); }
+
+  void RecordBytesOut(size_t bytes_out) { Add(ThreadShard().bytes_out, bytes_out); }
+
+  void RecordOptimization(size_t nodes_removed) {
+    Shard &shard = ThreadShard();
+    Add(shard.optimized_formulas, 1);
+    Add(shard.nodes_removed, nodes_removed);
+  }
+
+  void RecordNumericProgram() { Add(ThreadShard().numeric_formulas, 1); }
+
+  void RecordArenaChunk(size_t bytes) {
+    Shard &shard = ThreadShard();
+    Add(shard.arena_chunks, 1);
+    Add(shard.arena_bytes, bytes);
+  }
+
+  // The shard of the releasing thread may not be the one the chunks were recorded in: the shards
+  // are only meaningful summed, with unsigned wraparound.
+  void RecordArenaRelease(size_t chunks, size_t bytes) {
+    Shard &shard = ThreadShard();
+    Add(shard.arena_chunks, -static_cast<uint64_t>(chunks));
+    Add(shard.arena_bytes, -static_cast<uint64_t>(bytes));
+  }
+
+  void RecordArenaOversized() { Add(ThreadShard().arena_oversized, 1); }
+
+  void RecordPhase(EvalPhase phase, uint64_t elapsed_ns);
+
+  EvalStatsSnapshot Snapshot() const;
+
+  void Reset();
+
+ private:
+  struct PhaseCounters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::array<std::atomic<uint64_t>, kLatencyBuckets> histogram{};
+  };
+
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> optimized_formulas{0};
+    std::atomic<uint64_t> nodes_removed{0};
+    std::atomic<uint64_t> numeric_formulas{0};
+    std::atomic<uint64_t> arena_chunks{0};
+    std::atomic<uint64_t> arena_bytes{0};
+    std::atomic<uint64_t> arena_oversized{0};
+    std::array<PhaseCounters, kEvalPhaseCount> phases;
+  };
+
+  static void Add(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  // The shard of the calling thread, handed out to threads round-robin on first use.
+  Shard &ThreadShard();
+
+  std::array<Shard, kShards> shards_;
+  std::atomic<size_t> next_shard_{0};
+};
+
+/**
+ * @brief The counters shared by the plugin instances and the dart:ffi entry points.
+ */
+EvalStats &GlobalEvalStats();
+
+/**
+ * @brief Monotonic clock reading in nanoseconds, to time the evaluation phases.
+ */
+uint64_t MonotonicNanos();
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_EVAL_STATS_H_
@@ -0,0 +1,85 @@
+#include "parsec_eval_stream.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+namespace parsec_linux {
+
+bool EvalStream::Push(vector<string> formulas, bool *start_drain) {
+  lock_guard<mutex> lock(mutex_);
+  *start_drain = false;
+  if (closed_ || in_flight_ + formulas.size() > credits_) return false;
+
+  in_flight_ += formulas.size();
+  move(formulas.begin(), formulas.end(), back_inserter(queued_));
+  if (!draining_ && !queued_.empty()) {
+    draining_ = true;
+    *start_drain = true;
+  }
+  return true;
+}
+
+bool EvalStream::Take(vector<string> *formulas, size_t max) {
+  lock_guard<mutex> lock(mutex_);
+  formulas->clear();
+  if (closed_ || queued_.empty()) {
+    draining_ = false;
+    return false;
+  }
+
+  size_t count = min(max, queued_.size());
+  move(queued_.begin(), queued_.begin() + count, back_inserter(*formulas));
+  queued_.erase(queued_.begin(), queued_.begin() + count);
+  return true;
+}
+
+void EvalStream::Deliver(size_t count) {
+  lock_guard<mutex> lock(mutex_);
+  in_flight_ -= min(count, in_flight_);
+}
+
+void EvalStream::Close() {
+  lock_guard<mutex> lock(mutex_);
+  closed_ = true;
+  queued_.clear();
+}
+
+bool EvalStream::closed() const {
+  lock_guard<mutex> lock(mutex_);
+  return closed_;
+}
+
+shared_ptr<EvalStream> EvalStreamRegistry::Open(size_t credits) {
+  lock_guard<mutex> lock(mutex_);
+  int64_t id = next_id_++;
+  auto stream = make_shared<EvalStream>(id, credits);
+  streams_[id] = stream;
+  return stream;
+}
+
+shared_ptr<EvalStream> EvalStreamRegistry::Find(int64_t id) const {
+  lock_guard<mutex> lock(mutex_);
+  auto it = streams_.find(id);
+  return it == streams_.end() ? nullptr : it->second;
+}
+
+bool EvalStreamRegistry::Close(int64_t id) {
+  lock_guard<mutex> lock(mutex_);
+  auto it = streams_.find(id);
+  if (it == streams_.end()) return false;
+  it->second->Close();
+  streams_.erase(it);
+  return true;
+}
+
+void EvalStreamRegistry::CloseAll() {
+  lock_guard<mutex> lock(mutex_);
+  for (auto &entry : streams_) {
+    entry.second->Close();
+  }
+  streams_.clear();
+}
+
+}  // namespace parsec_linux
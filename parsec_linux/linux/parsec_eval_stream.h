@@ -0,0 +1,105 @@
+#ifndef PARSEC_LINUX_PARSEC_EVAL_STREAM_H_
+#define PARSEC_LINUX_PARSEC_EVAL_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace parsec_linux {
+
+/**
+ * @brief Queue of the formulas of a streaming evaluation, drained by one thread at a time so the
+ * results come out in the order the formulas were pushed.
+ *
+ * The stream holds a fixed number of credits: a formula takes one when it is pushed and gives it
+ * back once its result was delivered. Pushes that would overdraw the credits are rejected, which
+ * bounds the memory a producer faster than the evaluation can pin down.
+ *
+ * All methods are thread-safe.
+ */
+class EvalStream {
+ public:
+  EvalStream(int64_t id, size_t credits) : id_(id), credits_(credits) {}
+
+  int64_t id() const { return id_; }
+
+  /**
+   * @brief Queues @p formulas after the ones pushed before.
+   *
+   * Returns false, queuing none of them, when the stream is closed or lacks the credits. Sets
+   * @p start_drain when no thread is draining the stream, in which case the caller must start one.
+   */
+  bool Push(std::vector<std::string> formulas, bool *start_drain);
+
+  /**
+   * @brief Moves up to @p max queued formulas, oldest first, to @p formulas.
+   *
+   * Returns false, ending the drain, when none is left or the stream is closed.
+   */
+  bool Take(std::vector<std::string> *formulas, size_t max);
+
+  /**
+   * @brief Gives back the credits of @p count delivered results.
+   */
+  void Deliver(size_t count);
+
+  /**
+   * @brief Drops the queued formulas and rejects any further push.
+   */
+  void Close();
+
+  bool closed() const;
+
+ private:
+  const int64_t id_;
+  const size_t credits_;
+
+  mutable std::mutex mutex_;
+  std::deque<std::string> queued_;
+  // Formulas pushed whose results were not delivered yet, queued or being evaluated.
+  size_t in_flight_ = 0;
+  bool draining_ = false;
+  bool closed_ = false;
+};
+
+/**
+ * @brief Owns the open evaluation streams of a plugin instance and hands out integer ids for them.
+ *
+ * All methods are thread-safe.
+ */
+class EvalStreamRegistry {
+ public:
+  /**
+   * @brief Opens a stream with @p credits formulas in flight at most and returns it.
+   */
+  std::shared_ptr<EvalStream> Open(size_t credits);
+
+  /**
+   * @brief Returns the stream registered under @p id, or nullptr if there is none.
+   */
+  std::shared_ptr<EvalStream> Find(int64_t id) const;
+
+  /**
+   * @brief Closes the stream registered under @p id. Returns false if there was none.
+   */
+  bool Close(int64_t id);
+
+  /**
+   * @brief Closes every open stream.
+   */
+  void CloseAll();
+
+ private:
+  mutable std::mutex mutex_;
+  std::unordered_map<int64_t, std::shared_ptr<EvalStream>> streams_;
+  int64_t next_id_ = 1;
+};
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_EVAL_STREAM_H_
@@ -0,0 +1,365 @@
+#include "parsec_expression.h"
+
+#include <cctype>
+#include <unordered_set>
+
+using namespace std;
+
+namespace parsec_linux {
+
+int ExprGraph::Add(ExprKind kind, string text, vector<int> children) {
+  string key = to_string(static_cast<int>(kind)) + '\x1f' + text;
+  for (int child : children) {
+    key += '\x1f';
+    key += to_string(child);
+  }
+
+  auto it = index_.find(key);
+  if (it != index_.end()) return it->second;
+
+  int id = static_cast<int>(nodes_.size());
+  nodes_.push_back(ExprNode{kind, std::move(text), std::move(children)});
+  index_.emplace(std::move(key), id);
+  return id;
+}
+
+string ExprGraph::Render(int id, const unordered_map<int, string> *names) const {
+  string out;
+  Render(id, names, out);
+  return out;
+}
+
+void ExprGraph::Render(int id, const unordered_map<int, string> *names, string &out) const {
+  if (names != nullptr) {
+    auto it = names->find(id);
+    if (it != names->end()) {
+      out += it->second;
+      return;
+    }
+  }
+
+  const ExprNode &n = nodes_[id];
+  switch (n.kind) {
+    case ExprKind::kNumber:
+    case ExprKind::kString:
+    case ExprKind::kBoolean:
+    case ExprKind::kName:
+      out += n.text;
+      break;
+    case ExprKind::kUnary:
+      out += '(';
+      out += n.text;
+      Render(n.children[0], names, out);
+      out += ')';
+      break;
+    case ExprKind::kBinary:
+      out += '(';
+      Render(n.children[0], names, out);
+      out += ' ';
+      out += n.text;
+      out += ' ';
+      Render(n.children[1], names, out);
+      out += ')';
+      break;
+    case ExprKind::kPostfix:
+      out += '(';
+      Render(n.children[0], names, out);
+      out += n.text;
+      out += ')';
+      break;
+    case ExprKind::kTernary:
+      out += '(';
+      Render(n.children[0], names, out);
+      out += " ? ";
+      Render(n.children[1], names, out);
+      out += " : ";
+      Render(n.children[2], names, out);
+      out += ')';
+      break;
+    case ExprKind::kCall:
+      out += n.text;
+      out += '(';
+      for (size_t i = 0; i < n.children.size(); i++) {
+        if (i > 0) out += ", ";
+        Render(n.children[i], names, out);
+      }
+      out += ')';
+      break;
+  }
+}
+
+size_t ExprGraph::TreeSize(int id) const {
+  size_t size = 1;
+  for (int child : nodes_[id].children) {
+    size += TreeSize(child);
+  }
+  return size;
+}
+
+size_t ExprGraph::DagSize(int id) const {
+  unordered_set<int> visited;
+  vector<int> pending = {id};
+  while (!pending.empty()) {
+    int current = pending.back();
+    pending.pop_back();
+    if (!visited.insert(current).second) continue;
+    for (int child : nodes_[current].children) {
+      pending.push_back(child);
+    }
+  }
+  return visited.size();
+}
+
+namespace {
+
+// Thrown when the formula uses syntax the expression parser leaves to muparserx.
+struct Unsupported {};
+
+enum class TokenType { kNumber, kString, kName, kOperator, kLeftParen, kRightParen, kComma, kEnd };
+
+struct Token {
+  TokenType type;
+  string text;
+};
+
+class ExprParser {
+ public:
+  ExprParser(string_view formula, ExprGraph &graph) : formula_(formula), graph_(graph) {
+    Advance();
+  }
+
+  int Parse() {
+    int root = ParseExpr(0).id;
+    if (token_.type != TokenType::kEnd) throw Unsupported();
+    return root;
+  }
+
+ private:
+  struct Parsed {
+    int id;
+    // Whether the subexpression is atomic or was written between parentheses, so its operator
+    // cannot interact with the precedence of the surrounding ones.
+    bool grouped;
+  };
+
+  static int BindingPower(const string &op) {
+    if (op == "?") return 1;
+    if (op == "or" || op == "||") return 2;
+    if (op == "and" || op == "&&") return 3;
+    if (IsComparison(op)) return 4;
+    if (op == "+" || op == "-") return 5;
+    if (op == "*" || op == "/") return 6;
+    if (op == "^") return 8;
+    if (op == "!") return 9;
+    return 0;
+  }
+
+  static bool IsComparison(const string &op) {
+    return op == "==" || op == "!=" || op == "<" || op == ">" || op == "<=" || op == ">=";
+  }
+
+  static bool IsLogical(const string &op) {
+    return op == "and" || op == "&&" || op == "or" || op == "||";
+  }
+
+  // Binding power of a prefix minus: tighter than * and /, looser than ^ and the factorial.
+  static constexpr int kUnaryBindingPower = 7;
+
+  bool IsBinary(const Parsed &parsed, bool (*predicate)(const string &)) const {
+    const ExprNode &n = graph_.node(parsed.id);
+    return !parsed.grouped && n.kind == ExprKind::kBinary && predicate(n.text);
+  }
+
+  Parsed ParseExpr(int min_binding_power) {
+    Parsed left = ParsePrefix();
+
+    while (token_.type == TokenType::kOperator) {
+      string op = token_.text;
+      int binding_power = BindingPower(op);
+      // The ":" of a ternary ends its then branch.
+      if (binding_power == 0 || binding_power < min_binding_power) break;
+      Advance();
+
+      if (op == "!") {
+        left = {graph_.Add(ExprKind::kPostfix, op, {left.id}), false};
+      } else if (op == "?") {
+        Parsed then_branch = ParseExpr(0);
+        if (token_.type != TokenType::kOperator || token_.text != ":") throw Unsupported();
+        Advance();
+        // Right associative: a ? b : c ? d : e is a ? b : (c ? d : e).
+        Parsed else_branch = ParseExpr(binding_power);
+        left = {graph_.Add(ExprKind::kTernary, "?", {left.id, then_branch.id, else_branch.id}),
+                false};
+      } else {
+        Parsed right = ParseExpr(binding_power + 1);
+        if (op == "^" && IsBinary(left, [](const string &o) { return o == "^"; })) {
+          throw Unsupported();
+        }
+        if (IsComparison(op) && IsBinary(left, IsComparison)) throw Unsupported();
+        // Only chains of the same logical operator, and and or are not mixed without parentheses.
+        if (IsLogical(op) && (IsBinary(right, IsLogical) ||
+                              (IsBinary(left, IsLogical) && graph_.node(left.id).text != op))) {
+          throw Unsupported();
+        }
+        left = {graph_.Add(ExprKind::kBinary, op, {left.id, right.id}), false};
+      }
+    }
+    return left;
+  }
+
+  Parsed ParsePrefix() {
+    Token token = token_;
+    switch (token.type) {
+      case TokenType::kNumber:
+        Advance();
+        return {graph_.Add(ExprKind::kNumber, token.text), true};
+      case TokenType::kString:
+        Advance();
+        return {graph_.Add(ExprKind::kString, token.text), true};
+      case TokenType::kName:
+        Advance();
+        if (token.text == "true" || token.text == "false") {
+          return {graph_.Add(ExprKind::kBoolean, token.text), true};
+        }
+        if (token_.type == TokenType::kLeftParen) return {ParseCall(token.text), true};
+        return {graph_.Add(ExprKind::kName, token.text), true};
+      case TokenType::kLeftParen: {
+        Advance();
+        Parsed inner = ParseExpr(0);
+        if (token_.type != TokenType::kRightParen) throw Unsupported();
+        Advance();
+        return {inner.id, true};
+      }
+      case TokenType::kOperator:
+        if (token.text == "-") {
+          Advance();
+          Parsed operand = ParseExpr(kUnaryBindingPower);
+          // muparserx and the usual conventions disagree on -x^2 and -x!, so leave them alone.
+          const ExprNode &n = graph_.node(operand.id);
+          if (!operand.grouped && (n.kind == ExprKind::kPostfix || n.kind == ExprKind::kBinary)) {
+            throw Unsupported();
+          }
+          return {graph_.Add(ExprKind::kUnary, "-", {operand.id}), true};
+        }
+        throw Unsupported();
+      default:
+        throw Unsupported();
+    }
+  }
+
+  int ParseCall(const string &name) {
+    // Skip the opening parenthesis.
+    Advance();
+    vector<int> arguments;
+    if (token_.type != TokenType::kRightParen) {
+      while (true) {
+        arguments.push_back(ParseExpr(0).id);
+        if (token_.type == TokenType::kComma) {
+          Advance();
+          continue;
+        }
+        break;
+      }
+    }
+    if (token_.type != TokenType::kRightParen) throw Unsupported();
+    Advance();
+    return graph_.Add(ExprKind::kCall, name, std::move(arguments));
+  }
+
+  void Advance() {
+    while (position_ < formula_.size() && isspace(static_cast<unsigned char>(formula_[position_]))) {
+      position_++;
+    }
+    if (position_ >= formula_.size()) {
+      token_ = {TokenType::kEnd, ""};
+      return;
+    }
+
+    size_t start = position_;
+    char c = formula_[position_];
+    if (isdigit(static_cast<unsigned char>(c))) {
+      ReadNumber();
+      token_ = {TokenType::kNumber, string(formula_.substr(start, position_ - start))};
+    } else if (isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      while (position_ < formula_.size() &&
+             (isalnum(static_cast<unsigned char>(formula_[position_])) || formula_[position_] == '_')) {
+        position_++;
+      }
+      string name(formula_.substr(start, position_ - start));
+      bool is_operator = name == "and" || name == "or";
+      token_ = {is_operator ? TokenType::kOperator : TokenType::kName, name};
+    } else if (c == '"') {
+      position_++;
+      while (position_ < formula_.size() && formula_[position_] != '"') {
+        // Escapes are left to muparserx.
+        if (formula_[position_] == '\\') throw Unsupported();
+        position_++;
+      }
+      if (position_ >= formula_.size()) throw Unsupported();
+      position_++;
+      token_ = {TokenType::kString, string(formula_.substr(start, position_ - start))};
+    } else if (c == '(') {
+      position_++;
+      token_ = {TokenType::kLeftParen, "("};
+    } else if (c == ')') {
+      position_++;
+      token_ = {TokenType::kRightParen, ")"};
+    } else if (c == ',') {
+      position_++;
+      token_ = {TokenType::kComma, ","};
+    } else {
+      static const char *const kOperators[] = {
+          "==", "!=", "<=", ">=", "&&", "||", "+", "-", "*", "/", "^", "<", ">", "!", "?", ":"};
+      for (const char *op : kOperators) {
+        size_t length = char_traits<char>::length(op);
+        if (formula_.substr(position_, length) == op) {
+          position_ += length;
+          token_ = {TokenType::kOperator, op};
+          return;
+        }
+      }
+      throw Unsupported();
+    }
+  }
+
+  void ReadNumber() {
+    auto digits = [this] {
+      size_t start = position_;
+      while (position_ < formula_.size() && isdigit(static_cast<unsigned char>(formula_[position_]))) {
+        position_++;
+      }
+      return position_ > start;
+    };
+
+    digits();
+    if (position_ < formula_.size() && formula_[position_] == '.') {
+      position_++;
+      if (!digits()) throw Unsupported();
+    }
+    if (position_ < formula_.size() && (formula_[position_] == 'e' || formula_[position_] == 'E')) {
+      size_t exponent = position_++;
+      if (position_ < formula_.size() && (formula_[position_] == '+' || formula_[position_] == '-')) {
+        position_++;
+      }
+      // Not an exponent: 2e is 2 followed by the name e, which is not valid anyway.
+      if (!digits()) position_ = exponent;
+    }
+  }
+
+  string_view formula_;
+  ExprGraph &graph_;
+  size_t position_ = 0;
+  Token token_;
+};
+
+}  // namespace
+
+int ParseExpression(string_view formula, ExprGraph &graph) {
+  try {
+    return ExprParser(formula, graph).Parse();
+  } catch (Unsupported &) {
+    return -1;
+  }
+}
+
+}  // namespace parsec_linux
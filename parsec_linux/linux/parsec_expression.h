@@ -0,0 +1,88 @@
+#ifndef PARSEC_LINUX_PARSEC_EXPRESSION_H_
+#define PARSEC_LINUX_PARSEC_EXPRESSION_H_
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace parsec_linux {
+
+enum class ExprKind {
+  // Number literal, kept with its source text.
+  kNumber,
+  // String literal, kept with its quotes.
+  kString,
+  // true or false.
+  kBoolean,
+  // Variable or constant name.
+  kName,
+  // Prefix minus.
+  kUnary,
+  kBinary,
+  // Postfix operator, the factorial.
+  kPostfix,
+  // cond ? then : else
+  kTernary,
+  kCall,
+};
+
+struct ExprNode {
+  ExprKind kind;
+  // Literal text, name, operator or function name.
+  std::string text;
+  // Ids of the operands or arguments, in source order.
+  std::vector<int> children;
+};
+
+/**
+ * @brief Expression graph of a formula, with identical subexpressions sharing a single node.
+ *
+ * Nodes are hash-consed: adding a node equal to an existing one returns the existing id, so the
+ * graph of `(a+b)*sin(a+b)` holds `a+b` once. Children always have smaller ids than their parents.
+ */
+class ExprGraph {
+ public:
+  int Add(ExprKind kind, std::string text, std::vector<int> children = {});
+
+  const ExprNode &node(int id) const { return nodes_[id]; }
+
+  size_t size() const { return nodes_.size(); }
+
+  /**
+   * @brief Writes the subexpression @p id back as muparserx formula text, fully parenthesized so
+   * it does not depend on operator precedence. Nodes found in @p names are written as those names.
+   */
+  std::string Render(int id, const std::unordered_map<int, std::string> *names = nullptr) const;
+
+  /**
+   * @brief Number of nodes of subexpression @p id counted as a tree, that is as many times as the
+   * muparserx RPN of its text would hold them.
+   */
+  size_t TreeSize(int id) const;
+
+  /**
+   * @brief Number of distinct nodes reachable from @p id.
+   */
+  size_t DagSize(int id) const;
+
+ private:
+  void Render(int id, const std::unordered_map<int, std::string> *names, std::string &out) const;
+
+  std::vector<ExprNode> nodes_;
+  std::unordered_map<std::string, int> index_;
+};
+
+/**
+ * @brief Parses @p formula into @p graph and returns the id of its root.
+ *
+ * Only the part of the muparserx grammar whose meaning does not hinge on precedence subtleties is
+ * accepted: literals, names, calls, the arithmetic, comparison and logical operators, the
+ * factorial and ternaries. Anything else, like `-x^2`, `a^b^c` or chained comparisons without
+ * parentheses, returns -1 so the formula is left to muparserx as written.
+ */
+int ParseExpression(std::string_view formula, ExprGraph &graph);
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_EXPRESSION_H_
@@ -0,0 +1,282 @@
+#include "parsec_file_eval.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "parsec_value_json.h"
+
+using namespace std;
+
+namespace parsec_linux {
+
+namespace {
+
+// Lines evaluated between two progress reports, and per chunk handed to a thread.
+constexpr size_t kWindowLines = 65536;
+constexpr size_t kChunkLines = 1024;
+
+// The error of the failed call that just set errno.
+system_error FileError(const string &what, const string &path) {
+  int error = errno;
+  return system_error(error, generic_category(), what + " " + path);
+}
+
+// Closes a file descriptor when destroyed.
+class FileDescriptor {
+ public:
+  explicit FileDescriptor(int fd) : fd_(fd) {}
+  ~FileDescriptor() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+  int get() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+// Read-only private mapping of a whole file, unmapped when destroyed.
+class MappedFile {
+ public:
+  explicit MappedFile(const string &path) {
+    FileDescriptor fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) throw FileError("Cannot open", path);
+
+    if (fstat(fd.get(), &info_) != 0) throw FileError("Cannot stat", path);
+    size_ = static_cast<size_t>(info_.st_size);
+    if (size_ == 0) return;
+
+    void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (data == MAP_FAILED) throw FileError("Cannot map", path);
+    data_ = static_cast<const char*>(data);
+    // Lines are read once, front to back.
+    madvise(data, size_, MADV_SEQUENTIAL);
+  }
+
+  ~MappedFile() {
+    if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  string_view contents() const { return string_view(data_, size_); }
+
+  // Whether @p path names the mapped file, through the same or another link.
+  bool SameFile(const string &path) const {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && info.st_dev == info_.st_dev &&
+           info.st_ino == info_.st_ino;
+  }
+
+ private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  struct stat info_;
+};
+
+// File created next to @p path and renamed over it by Commit(), or removed when destroyed before,
+// so @p path never holds a partial output.
+class TemporaryOutput {
+ public:
+  // Opened with O_EXCL under a random name rather than with mkostemp, which always creates 0600
+  // files: the output gets the mode the umask gives new files.
+  explicit TemporaryOutput(const string &path) : path_(path) {
+    random_device random;
+    for (int attempt = 0; attempt < 100; attempt++) {
+      char suffix[16];
+      snprintf(suffix, sizeof(suffix), ".%08x", static_cast<unsigned>(random()));
+      temporary_ = path + suffix;
+      fd_ = open(temporary_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+      if (fd_ >= 0 || errno != EEXIST) break;
+    }
+    if (fd_ < 0) throw FileError("Cannot create", path);
+  }
+
+  ~TemporaryOutput() {
+    if (fd_ >= 0) {
+      close(fd_);
+      unlink(temporary_.c_str());
+    }
+  }
+
+  TemporaryOutput(const TemporaryOutput&) = delete;
+  TemporaryOutput& operator=(const TemporaryOutput&) = delete;
+
+  int get() const { return fd_; }
+
+  void Commit() {
+    int fd = fd_;
+    fd_ = -1;
+    if (close(fd) != 0 || rename(temporary_.c_str(), path_.c_str()) != 0) {
+      system_error error = FileError("Cannot write", path_);
+      unlink(temporary_.c_str());
+      throw error;
+    }
+  }
+
+ private:
+  string path_;
+  string temporary_;
+  int fd_ = -1;
+};
+
+void WriteAll(int fd, const string &buffer, const string &path) {
+  const char *data = buffer.data();
+  size_t left = buffer.size();
+  while (left > 0) {
+    ssize_t written = write(fd, data, left);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      throw FileError("Cannot write", path);
+    }
+    data += written;
+    left -= static_cast<size_t>(written);
+  }
+}
+
+template <typename T>
+void AppendRaw(string &out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendBinaryText(string &out, char type, const string &text) {
+  out += type;
+  AppendRaw(out, static_cast<uint32_t>(text.size()));
+  out += text;
+}
+
+// Whether @json is the CalcJson text of a result rather than of an error.
+bool IsResultJson(const string &json) {
+  static const string_view kResultEnd = "\"error\": null}";
+  return json.size() >= kResultEnd.size() &&
+         string_view(json).substr(json.size() - kResultEnd.size()) == kResultEnd;
+}
+
+void AppendValueRecord(const mup::IValue &value, string &out) {
+  switch (value.GetType()) {
+    case 'f':
+      out += 'f';
+      AppendRaw(out, static_cast<double>(value.GetFloat()));
+      break;
+    case 'i':
+      out += 'i';
+      AppendRaw(out, static_cast<int64_t>(value.GetInteger()));
+      break;
+    case 'b':
+      out += 'b';
+      out += static_cast<char>(value.GetBool() ? 1 : 0);
+      break;
+    case 's':
+      AppendBinaryText(out, 's', value.GetString());
+      break;
+    default:
+      AppendBinaryText(out, 's', value.ToString());
+  }
+}
+
+}  // namespace
+
+FileEvalProgress EvaluateFile(const string &input_path, const string &output_path,
+                              FileRecordFormat format, FormulaCache &cache,
+                              ParallelExecutor &executor, const FileEvalProgressCallback &progress) {
+  MappedFile input(input_path);
+  // Writing over the mapped input would truncate it under the evaluation, which then faults.
+  if (input.SameFile(output_path)) {
+    throw system_error(make_error_code(errc::invalid_argument),
+                       "Cannot write the results over the input " + input_path);
+  }
+  TemporaryOutput output(output_path);
+
+  string_view contents = input.contents();
+  FileEvalProgress counters;
+  counters.bytes_total = contents.size();
+
+  // Reused by every window: the lines point into the mapping, and each chunk of lines gets its own
+  // record buffer and error count so the threads never share one.
+  vector<string_view> lines;
+  vector<string> records;
+  vector<size_t> errors;
+  lines.reserve(kWindowLines);
+
+  size_t position = 0;
+  while (position < contents.size()) {
+    lines.clear();
+    while (lines.size() < kWindowLines && position < contents.size()) {
+      size_t end = contents.find('\n', position);
+      if (end == string_view::npos) end = contents.size();
+
+      string_view line = contents.substr(position, end - position);
+      if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+      lines.push_back(line);
+      position = end + 1;
+    }
+
+    size_t chunks = (lines.size() + kChunkLines - 1) / kChunkLines;
+    records.resize(max(records.size(), chunks));
+    errors.assign(chunks, 0);
+
+    executor.For(lines.size(), kChunkLines, [&](size_t begin, size_t end, size_t participant) {
+      FormulaCache &shard = cache.Shard(participant);
+      // Chunks start at multiples of kChunkLines, but inline runs cover the whole window at once.
+      for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += kChunkLines) {
+        size_t chunk = chunk_begin / kChunkLines;
+        string &out = records[chunk];
+        out.clear();
+        for (size_t i = chunk_begin; i < min(end, chunk_begin + kChunkLines); i++) {
+          if (format == FileRecordFormat::kJson) {
+            // Reused by the records of the calling thread.
+            static thread_local string json;
+            EvalJson(lines[i], json);
+            if (!IsResultJson(json)) errors[chunk]++;
+            out += json;
+            out += '\n';
+            continue;
+          }
+
+          size_t size = EvalCached(
+              shard, lines[i],
+              [&](const mup::IValue &value) {
+                size_t before = out.size();
+                AppendValueRecord(value, out);
+                return out.size() - before;
+              },
+              [&](const string &message) {
+                size_t before = out.size();
+                AppendBinaryText(out, 'e', message);
+                errors[chunk]++;
+                return out.size() - before;
+              });
+          GlobalEvalStats().RecordBytesOut(size);
+        }
+      }
+    });
+
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+      WriteAll(output.get(), records[chunk], output_path);
+      counters.errors += errors[chunk];
+    }
+    counters.lines += lines.size();
+    counters.bytes_read = min(position, contents.size());
+    if (progress) progress(counters);
+  }
+
+  output.Commit();
+  return counters;
+}
+
+}  // namespace parsec_linux
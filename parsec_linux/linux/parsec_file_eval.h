@@ -0,0 +1,64 @@
+#ifndef PARSEC_LINUX_PARSEC_FILE_EVAL_H_
+#define PARSEC_LINUX_PARSEC_FILE_EVAL_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "parsec_formula_cache.h"
+#include "parsec_parallel.h"
+
+namespace parsec_linux {
+
+/**
+ * @brief Layout of the result records written by EvaluateFile(), one per input line.
+ */
+enum class FileRecordFormat {
+  // The CalcJson text of the result, as returned by CalcJson itself, followed by a newline.
+  kJson,
+  // A type byte, as in CalcJson or 'e' for errors, followed by the value in host byte order: an
+  // 8 byte double for 'f', an 8 byte integer for 'i', a byte for 'b', and a 4 byte length and the
+  // bytes of the text for 's' and 'e'. Results of any other type are written as 's' records.
+  kBinary,
+};
+
+/**
+ * @brief Counters of a file evaluation, reported as it progresses.
+ */
+struct FileEvalProgress {
+  size_t lines = 0;
+  size_t errors = 0;
+  size_t bytes_read = 0;
+  size_t bytes_total = 0;
+};
+
+using FileEvalProgressCallback = std::function<void(const FileEvalProgress&)>;
+
+/**
+ * @brief Evaluates every line of the file at @p input_path as a formula, with CalcJson semantics,
+ * and writes one result record per line to the file at @p output_path, in line order.
+ *
+ * The input is memory-mapped. JSON records come from CalcJson, and binary records from an
+ * evaluation of the line in place, each thread going through its own FormulaCache::Shard() of
+ * @p cache, so no line is copied unless its formula is not cached yet. @p cache is best private to
+ * the call: most lines are only evaluated once, and would evict the formulas of a shared cache.
+ *
+ * Lines are processed in windows split across the threads of @p executor; @p progress is called on
+ * the calling thread after each window is written. Blank lines are evaluated too, so the n-th
+ * record always answers the n-th line.
+ *
+ * Records are written to a temporary file next to @p output_path, renamed over it once every line
+ * is evaluated, so @p output_path is left untouched if the evaluation fails.
+ *
+ * Returns the final counters.
+ *
+ * @throws std::system_error if a file cannot be opened, mapped or written, or if @p output_path
+ * names the input file.
+ */
+FileEvalProgress EvaluateFile(const std::string &input_path, const std::string &output_path,
+                              FileRecordFormat format, FormulaCache &cache,
+                              ParallelExecutor &executor, const FileEvalProgressCallback &progress);
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_FILE_EVAL_H_
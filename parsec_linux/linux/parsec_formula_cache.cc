@@ -0,0 +1,82 @@
+#include "parsec_formula_cache.h"
+
+using namespace std;
+
+namespace parsec_linux {
+
+shared_ptr<CompiledFormula> FormulaCache::Get(string_view formula) {
+  lock_guard<mutex> lock(mutex_);
+  auto it = index_.find(formula);
+  if (it != index_.end()) {
+    hits_++;
+    // Move the entry to the front, it is now the most recently used
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return *it->second;
+  }
+
+  misses_++;
+  auto compiled = make_shared<CompiledFormula>(string(formula));
+  if (capacity_ == 0) return compiled;
+
+  entries_.push_front(compiled);
+  index_.emplace(compiled->formula(), entries_.begin());
+  EvictExcess();
+  return compiled;
+}
+
+void FormulaCache::SetCapacity(size_t capacity) {
+  lock_guard<mutex> shards(shards_mutex_);
+  for (unique_ptr<FormulaCache> &shard : shards_) {
+    if (shard != nullptr) shard->SetCapacity(capacity);
+  }
+  lock_guard<mutex> lock(mutex_);
+  capacity_ = capacity;
+  EvictExcess();
+}
+
+FormulaCache &FormulaCache::Shard(size_t participant) {
+  if (participant == 0) return *this;
+  lock_guard<mutex> shards(shards_mutex_);
+  if (shards_.size() < participant) shards_.resize(participant);
+  unique_ptr<FormulaCache> &shard = shards_[participant - 1];
+  if (shard == nullptr) {
+    lock_guard<mutex> lock(mutex_);
+    shard = make_unique<FormulaCache>(capacity_);
+  }
+  return *shard;
+}
+
+FormulaCacheStats FormulaCache::stats() const {
+  lock_guard<mutex> shards(shards_mutex_);
+  FormulaCacheStats stats = OwnStats();
+  for (const unique_ptr<FormulaCache> &shard : shards_) {
+    if (shard == nullptr) continue;
+    FormulaCacheStats shard_stats = shard->OwnStats();
+    stats.hits += shard_stats.hits;
+    stats.misses += shard_stats.misses;
+    stats.evictions += shard_stats.evictions;
+    stats.size += shard_stats.size;
+  }
+  return stats;
+}
+
+FormulaCacheStats FormulaCache::OwnStats() const {
+  lock_guard<mutex> lock(mutex_);
+  FormulaCacheStats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  stats.size = entries_.size();
+  stats.capacity = capacity_;
+  return stats;
+}
+
+void FormulaCache::EvictExcess() {
+  while (entries_.size() > capacity_) {
+    index_.erase(entries_.back()->formula());
+    entries_.pop_back();
+    evictions_++;
+  }
+}
+
+}  // namespace parsec_linux
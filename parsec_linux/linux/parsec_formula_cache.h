@@ -0,0 +1,136 @@
+#ifndef PARSEC_LINUX_PARSEC_FORMULA_CACHE_H_
+#define PARSEC_LINUX_PARSEC_FORMULA_CACHE_H_
+
+#include <cstdint>
+#include <exception>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "parsec_compiled_formula.h"
+#include "parsec_eval_stats.h"
+
+namespace parsec_linux {
+
+/**
+ * @brief Counters describing how well the FormulaCache is doing.
+ */
+struct FormulaCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  size_t size = 0;
+  size_t capacity = 0;
+};
+
+/**
+ * @brief Bounded LRU cache mapping formula text to its parsed muparserx formula.
+ *
+ * A repeated formula string skips tokenizing and RPN construction: the cached parser evaluates
+ * straight from the RPN it built the first time. All methods are thread-safe; evaluating a returned
+ * formula still requires holding its mutex.
+ */
+class FormulaCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 512;
+
+  explicit FormulaCache(size_t capacity = kDefaultCapacity) : capacity_(capacity) {}
+
+  /**
+   * @brief Returns the parsed formula for @p formula, parsing and caching it on a miss.
+   *
+   * The least recently used entry is evicted when the cache is full. With a capacity of 0 caching
+   * is disabled and every call returns a freshly parsed formula.
+   */
+  std::shared_ptr<CompiledFormula> Get(std::string_view formula);
+
+  /**
+   * @brief Changes the maximum number of cached formulas, evicting the excess right away.
+   *
+   * Applies to the shards too.
+   */
+  void SetCapacity(size_t capacity);
+
+  /**
+   * @brief Returns the cache participant @p participant of a ParallelExecutor::For() call
+   * evaluates through: this cache for participant 0, which may be the calling thread of an inline
+   * run, and a shard of it created on first use for each other one.
+   *
+   * A formula repeated across a split batch is parsed once per participant rather than shared, so
+   * threads never wait on each other's parser mutex. Shards follow the capacity of this cache and
+   * are counted in its stats().
+   */
+  FormulaCache &Shard(size_t participant);
+
+  /**
+   * @brief Counters of this cache and its shards summed, with the capacity of each of them.
+   */
+  FormulaCacheStats stats() const;
+
+ private:
+  FormulaCacheStats OwnStats() const;
+  void EvictExcess();
+
+  using Entries = std::list<std::shared_ptr<CompiledFormula>>;
+
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  // Most recently used entries first.
+  Entries entries_;
+  // Keys point into the formula text owned by the cached entries.
+  std::unordered_map<std::string_view, Entries::iterator> index_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+
+  // Guards shards_, taken before mutex_ when both are held.
+  mutable std::mutex shards_mutex_;
+  // Shard of participant p at index p - 1.
+  std::vector<std::unique_ptr<FormulaCache>> shards_;
+};
+
+/**
+ * @brief Evaluates @p formula through @p cache and returns `serialize(value)`, or `fail(message)`
+ * when it fails, recording the call and the time of each phase in GlobalEvalStats().
+ *
+ * The parse phase is only recorded for formulas that were not parsed yet, and includes setting up
+ * the parser of a cache miss.
+ */
+template <typename Serialize, typename Fail>
+auto EvalCached(FormulaCache &cache, std::string_view formula, Serialize &&serialize, Fail &&fail)
+    -> decltype(fail(std::string())) {
+  EvalStats &stats = GlobalEvalStats();
+  stats.RecordCall(formula.size());
+  try {
+    uint64_t start = MonotonicNanos();
+    std::shared_ptr<CompiledFormula> compiled = cache.Get(formula);
+    std::lock_guard<std::mutex> lock(compiled->mutex());
+    if (!compiled->parsed()) {
+      compiled->Parse();
+      stats.RecordPhase(EvalPhase::kParse, MonotonicNanos() - start);
+    }
+
+    start = MonotonicNanos();
+    const mup::IValue &value = compiled->Evaluate();
+    uint64_t evaluated = MonotonicNanos();
+    stats.RecordPhase(EvalPhase::kEvaluate, evaluated - start);
+
+    auto result = serialize(value);
+    stats.RecordPhase(EvalPhase::kSerialize, MonotonicNanos() - evaluated);
+    return result;
+  } catch (mup::ParserError &error) {
+    stats.RecordError();
+    return fail(error.GetMsg());
+  } catch (std::exception &error) {
+    stats.RecordError();
+    return fail(error.what());
+  }
+}
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_FORMULA_CACHE_H_
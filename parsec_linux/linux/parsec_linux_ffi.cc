@@ -0,0 +1,17 @@
+#include "include/parsec_linux/parsec_linux_ffi.h"
+
+#include <string>
+#include <string_view>
+
+#include "parsec_value_json.h"
+
+using namespace std;
+
+const char* parsec_eval_json(const char* formula, size_t formula_length, size_t* result_length) {
+  // Kept per thread so the returned pointer needs no free call from Dart
+  static thread_local string result;
+  parsec_linux::EvalJson(string_view(formula, formula_length), result);
+
+  if (result_length != nullptr) *result_length = result.size();
+  return result.c_str();
+}
@@ -4,58 +4,296 @@
 #include <gtk/gtk.h>
 #include <sys/utsname.h>
 
+#include <algorithm>
 #include <cstring>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <iostream>
 #include "equationsParser.h"
+#include "parsec_compiled_formula.h"
+#include "parsec_eval_arena.h"
+#include "parsec_eval_stats.h"
+#include "parsec_eval_stream.h"
+#include "parsec_file_eval.h"
+#include "parsec_formula_cache.h"
+#include "parsec_parallel.h"
+#include "parsec_parser_pool.h"
+#include "parsec_sheet.h"
+#include "parsec_value_json.h"
 
 using namespace std;
 using namespace EquationsParser;
+using parsec_linux::CompiledFormula;
+using parsec_linux::EvalPhase;
+using parsec_linux::EvalStats;
+using parsec_linux::EvalStatsSnapshot;
+using parsec_linux::EvalStream;
+using parsec_linux::EvalStreamRegistry;
+using parsec_linux::FileEvalProgress;
+using parsec_linux::FileRecordFormat;
+using parsec_linux::FormulaCache;
+using parsec_linux::FormulaCacheStats;
+using parsec_linux::FormulaRegistry;
+using parsec_linux::FormulaSheet;
+using parsec_linux::ParallelExecutor;
+using parsec_linux::SheetRegistry;
 
 #define PARSEC_LINUX_PLUGIN(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), parsec_linux_plugin_get_type(), \
                               ParsecLinuxPlugin))
 
 struct _ParsecLinuxPlugin {
   GObject parent_instance;
+
+  // Formulas compiled through "nativeCompile", owned by this plugin instance.
+  FormulaRegistry* formulas;
+
+  // Sheets created through "createSheet", owned by this plugin instance.
+  SheetRegistry* sheets;
+
+  // Parsed formulas of "nativeEval" and "nativeEvalBatch", keyed by formula text.
+  FormulaCache* cache;
+
+  // Worker threads running the evaluation methods off the platform thread, or nullptr when
+  // evaluations run synchronously on the platform thread.
+  GThreadPool* workers;
+
+  // Maximum number of evaluations waiting for a free worker before new ones are rejected.
+  guint max_queue_depth;
+
+  // Threads splitting a single large batch or columns evaluation across cores.
+  ParallelExecutor* parallel;
+
+  // Streaming evaluations opened through "openEvalStream", and the event channel their results are
+  // sent on.
+  EvalStreamRegistry* streams;
+  FlEventChannel* stream_channel;
+
+  // Threads draining the evaluation streams, one stream at a time each.
+  GThreadPool* stream_workers;
+
+  // Event channel the progress of "evalFile" jobs is sent on.
+  FlEventChannel* file_channel;
 };
 
+// Default maximum number of evaluations waiting for a free worker.
+static const guint kDefaultMaxQueueDepth = 65536;
+
+// Smallest batch and columns evaluations split across cores: below these, waking the threads costs
+// more than it saves.
+static const size_t kParallelBatchMinLength = 128;
+static const size_t kParallelMinRows = 16384;
+
+// Credits of an evaluation stream when "openEvalStream" names none, and the most it may ask for.
+static const size_t kDefaultStreamCredits = 64;
+static const size_t kMaxStreamCredits = 65536;
+
+// Most results sent in a single stream event, so the first results of a long run of queued
+// formulas are not held back until the last one is evaluated.
+static const size_t kStreamEventMaxLength = 64;
+
 G_DEFINE_TYPE(ParsecLinuxPlugin, parsec_linux_plugin, g_object_get_type())
 
+typedef struct {
+  FlMethodCall* method_call;
+  FlMethodResponse* response;
+} ParsecLinuxPendingResponse;
+
+/**
+ * @user_data: the ParsecLinuxPendingResponse to send
+ *
+ * Sends a response on the platform thread, where the main context runs, and frees it.
+ */
+static gboolean parsec_linux_plugin_send_response(gpointer user_data) {
+    ParsecLinuxPendingResponse* pending = static_cast<ParsecLinuxPendingResponse*>(user_data);
+
+    fl_method_call_respond(pending->method_call, pending->response, nullptr);
+
+    g_object_unref(pending->method_call);
+    g_object_unref(pending->response);
+    g_free(pending);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * @method_call: the FlMethodCall to respond to
+ * @response: the FlMethodResponse to send back
+ *
+ * Responds to @method_call from any thread. When called from a worker thread the response is
+ * posted to the main context and sent from the platform thread; on the platform thread it is sent
+ * right away. Replies may complete out of order, the channel matches each one to its call.
+ */
+static void parsec_linux_plugin_respond(FlMethodCall* method_call, FlMethodResponse* response) {
+    ParsecLinuxPendingResponse* pending = g_new(ParsecLinuxPendingResponse, 1);
+    pending->method_call = static_cast<FlMethodCall*>(g_object_ref(method_call));
+    pending->response = static_cast<FlMethodResponse*>(g_object_ref(response));
+
+    g_main_context_invoke(nullptr, parsec_linux_plugin_send_response, pending);
+}
+
 
 /**
- * @text_value: a pointer to the FlValue of the input text
  * @method_call: a pointer to the FlMethodCall object
+ * @value: a pointer to the FlValue of the input argument
+ * @expected_type: the FlValueType the argument must have, a string by default
  *
- * This function checks if the input text is valid, i.e. not null and of type string.
+ * This function checks if the input argument is valid, i.e. not null and of the expected type.
  * If the input is invalid, it sends a not implemented response and sets the error to null.
  * Otherwise, it returns true.
  */
-static bool parsec_linux_plugin_check_valid_input(FlMethodCall* method_call, FlValue *text_value) {
-    // Check if argument value is either null or string
-    if (text_value == nullptr || fl_value_get_type(text_value) != FL_VALUE_TYPE_STRING) {
+static bool parsec_linux_plugin_check_valid_input(FlMethodCall* method_call, FlValue *value,
+                                                  FlValueType expected_type = FL_VALUE_TYPE_STRING) {
+    // Check if argument value is either null or of the expected type
+    if (value == nullptr || fl_value_get_type(value) != expected_type) {
         // Return error
         g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
-        // Create error, in this case null
-        g_autoptr(GError) error = nullptr;
-
         // Send response back to dart
-        fl_method_call_respond(method_call, response, &error);
+        parsec_linux_plugin_respond(method_call, response);
         return false;
     }
     return true;
 }
 
+/**
+ * @value: a pointer to the FlValue sent by the Dart code
+ * @out: the muparserx value to assign
+ *
+ * Converts a standard codec scalar (int, double, bool or string) into a muparserx value.
+ * Returns false if the FlValue holds any other type.
+ */
+static bool parsec_linux_plugin_value_from_fl(FlValue *value, mup::Value *out) {
+    switch (fl_value_get_type(value)) {
+        case FL_VALUE_TYPE_INT: {
+            int64_t integer = fl_value_get_int(value);
+            // muparserx integers are 32 bits wide, larger ones are kept as floats
+            if (integer >= INT32_MIN && integer <= INT32_MAX) {
+                *out = mup::Value((mup::int_type) integer);
+            } else {
+                *out = mup::Value((mup::float_type) integer);
+            }
+            return true;
+        }
+        case FL_VALUE_TYPE_FLOAT:
+            *out = mup::Value((mup::float_type) fl_value_get_float(value));
+            return true;
+        case FL_VALUE_TYPE_BOOL:
+            *out = mup::Value((bool) fl_value_get_bool(value));
+            return true;
+        case FL_VALUE_TYPE_STRING:
+            *out = mup::Value(mup::string_type(fl_value_get_string(value)));
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @value: the muparserx value produced by an evaluation
+ *
+ * Converts a muparserx value into the matching standard codec type, so Dart receives an int,
+ * double, bool or string without going through JSON. Values without a codec counterpart, such as
+ * complex numbers and matrices, are sent as their string representation.
+ */
+static FlValue* parsec_linux_plugin_value_to_fl(const mup::IValue &value) {
+    switch (value.GetType()) {
+        case 'i':
+            return fl_value_new_int(value.GetInteger());
+        case 'f':
+            return fl_value_new_float(value.GetFloat());
+        case 'b':
+            return fl_value_new_bool(value.GetBool());
+        case 's':
+            return fl_value_new_string(value.GetString().c_str());
+        default:
+            return fl_value_new_string(value.ToString().c_str());
+    }
+}
+
+/**
+ * @value: an evaluation result
+ *
+ * Returns the number of bytes @value takes in the codec, counted as the bytes sent out in the
+ * evaluation stats.
+ */
+static size_t parsec_linux_plugin_value_size(const mup::IValue &value) {
+    return value.GetType() == 's' ? value.GetString().size() : sizeof(double);
+}
+
+/**
+ * @val: the typed value of a successful evaluation, or nullptr
+ * @error: the error message of a failed evaluation, or nullptr
+ *
+ * Builds the {"val": ..., "error": ...} map returned by the typed evaluation methods. Ownership of
+ * @val is taken.
+ */
+static FlValue* parsec_linux_plugin_typed_result_new(FlValue *val, const gchar *error) {
+    FlValue *result = fl_value_new_map();
+    fl_value_set_string_take(result, "val", val != nullptr ? val : fl_value_new_null());
+    fl_value_set_string_take(result, "error",
+                             error != nullptr ? fl_value_new_string(error) : fl_value_new_null());
+    return result;
+}
+
+/**
+ * @args: the FlValue map of arguments sent by the Dart code
+ *
+ * Returns true if the Dart code asked for typed results with a "typed" argument set to true,
+ * rather than the CalcJson strings.
+ */
+static bool parsec_linux_plugin_wants_typed_result(FlValue *args) {
+    FlValue *typed_value = fl_value_lookup_string(args, "typed");
+    return typed_value != nullptr && fl_value_get_type(typed_value) == FL_VALUE_TYPE_BOOL &&
+           fl_value_get_bool(typed_value);
+}
+
+/**
+ * @cache: the formula cache to evaluate through
+ * @formula: the formula text to evaluate
+ *
+ * Evaluates @formula through @cache and returns the result as a typed {"val": ..., "error": ...}
+ * map, so numbers are never formatted to text and parsed back.
+ */
+static FlValue* parsec_linux_plugin_calc_typed(FormulaCache &cache, const string &formula) {
+    return parsec_linux::EvalCached(
+        cache, formula,
+        [](const mup::IValue &value) {
+            parsec_linux::GlobalEvalStats().RecordBytesOut(parsec_linux_plugin_value_size(value));
+            return parsec_linux_plugin_typed_result_new(parsec_linux_plugin_value_to_fl(value), nullptr);
+        },
+        [](const string &message) {
+            return parsec_linux_plugin_typed_result_new(nullptr, message.c_str());
+        });
+}
+
+/**
+ * @cache: the formula cache to evaluate through
+ * @formula: the formula text to evaluate
+ * @typed: whether to return a typed result map instead of a CalcJson string
+ *
+ * Evaluates @formula with the same result as CalcJson. Typed results go through @cache, so a
+ * formula that was evaluated recently is not tokenized nor converted to RPN again, while CalcJson
+ * strings come from CalcJson itself.
+ */
+static FlValue* parsec_linux_plugin_calc(FormulaCache &cache, const string &formula, bool typed) {
+    if (typed) return parsec_linux_plugin_calc_typed(cache, formula);
+
+    string ans = parsec_linux::EvalJson(formula);
+    return fl_value_new_string_sized(ans.data(), ans.size());
+}
+
 /**
 
 @brief Handles the nativeEval method call.
 
 Extracts the equation passed as an argument, performs the calculation and sends the result back to
-the Dart code.
+the Dart code, as a CalcJson string or, when the "typed" argument is true, as a typed
+{"val": ..., "error": ...} map.
 
+@param[in] self The ParsecLinuxPlugin instance owning the formula cache.
 @param[in] method_call The FlMethodCall object representing the method call.
-@param[in] text_value The FlValue object containing the "equation" argument passed by the Dart code.
 */
-static void parsec_linux_plugin_handle_native_eval(FlMethodCall* method_call) {
+static void parsec_linux_plugin_handle_native_eval(ParsecLinuxPlugin* self,
+                                                   FlMethodCall* method_call) {
     // Get Dart arguments
     FlValue* args = fl_method_call_get_args(method_call);
     // Fetch string value named "equation"
@@ -64,12 +302,1009 @@ static void parsec_linux_plugin_handle_native_eval(FlMethodCall* method_call) {
     if (!parsec_linux_plugin_check_valid_input(method_call, text_value)) return;
 
     string formula = fl_value_get_string(text_value);
-    string ans = CalcJson(formula);
+    g_autoptr(FlValue) result =
+        parsec_linux_plugin_calc(*self->cache, formula, parsec_linux_plugin_wants_typed_result(args));
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+ * @cache: the formula cache to evaluate through
+ * @text_value: an item of the "equations" list of nativeEvalBatch
+ * @typed: whether to return a typed result map instead of a CalcJson string
+ *
+ * Evaluates one equation of a batch, or returns its error if it is not a string.
+ */
+static FlValue* parsec_linux_plugin_calc_batch_item(FormulaCache &cache, FlValue *text_value,
+                                                    bool typed) {
+    if (fl_value_get_type(text_value) == FL_VALUE_TYPE_STRING) {
+        return parsec_linux_plugin_calc(cache, fl_value_get_string(text_value), typed);
+    } else if (typed) {
+        return parsec_linux_plugin_typed_result_new(nullptr, "Equation must be a string");
+    } else {
+        string ans = parsec_linux::ErrorToJson("Equation must be a string");
+        return fl_value_new_string(ans.c_str());
+    }
+}
+
+/**
+
+@brief Handles the nativeEvalBatch method call.
+
+Evaluates every equation of the "equations" list argument in a single method call, so the channel
+dispatch and codec overhead is paid once per batch instead of once per equation. The response is a
+list holding the result of each equation in input order, as for nativeEval; an equation that fails
+to evaluate only carries its error in its own slot.
+
+Large batches are split across the cores by the parallel executor, each thread evaluating through
+its own shard of the plugin formula cache so no parser is shared; results keep the input order.
+
+@param[in] self The ParsecLinuxPlugin instance owning the formula cache.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_native_eval_batch(ParsecLinuxPlugin* self,
+                                                         FlMethodCall* method_call) {
+    // Get Dart arguments
+    FlValue* args = fl_method_call_get_args(method_call);
+    // Fetch list value named "equations"
+    FlValue *list_value = fl_value_lookup_string(args, "equations");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, list_value, FL_VALUE_TYPE_LIST)) return;
+
+    bool typed = parsec_linux_plugin_wants_typed_result(args);
+    size_t length = fl_value_get_length(list_value);
+    size_t threads = self->parallel->threads();
+
+    // Each slot is only written by the thread evaluating its equation.
+    vector<FlValue*> items(length);
+    if (length >= kParallelBatchMinLength && threads > 1) {
+        size_t grain = max<size_t>(16, length / (threads * 8));
+        self->parallel->For(length, grain, [&](size_t begin, size_t end, size_t participant) {
+            FormulaCache &cache = self->cache->Shard(participant);
+            for (size_t i = begin; i < end; i++) {
+                items[i] = parsec_linux_plugin_calc_batch_item(
+                    cache, fl_value_get_list_value(list_value, i), typed);
+            }
+        });
+    } else {
+        for (size_t i = 0; i < length; i++) {
+            items[i] = parsec_linux_plugin_calc_batch_item(
+                *self->cache, fl_value_get_list_value(list_value, i), typed);
+        }
+    }
+
+    g_autoptr(FlValue) result = fl_value_new_list();
+    for (FlValue *item : items) {
+        fl_value_append_take(result, item);
+    }
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+ * @stats: the evaluation counters
+ * @formula: a formula compiled with optimization
+ *
+ * Counts @formula in the optimizer counters if the optimizer rewrote it or lowered it to the
+ * numeric engine.
+ */
+static void parsec_linux_plugin_record_optimization(EvalStats &stats, const CompiledFormula &formula) {
+    if (formula.numeric()) stats.RecordNumericProgram();
+    const parsec_linux::OptimizerStats &optimizer_stats = formula.optimizer_stats();
+    if (optimizer_stats.nodes_before > 0) stats.RecordOptimization(optimizer_stats.nodes_removed());
+}
+
+/**
+
+@brief Handles the nativeEvalColumns method call.
+
+Evaluates the "equation" argument once per row of the "columns" argument, a map from variable name
+to a Float64List column, all of the same length. The columns arrive as FL_VALUE_TYPE_FLOAT_LIST, so
+rows are bound to the parsed formula directly from the codec buffers, without formatting them into
+strings. The response is a {"values": Float64List, "errors": Uint8List} map, where "errors" is a
+bitmap of the rows that failed to evaluate, or a "compile_error" error response when the equation
+is invalid. Large columns are split across the cores by the parallel executor.
+
+@param[in] self The ParsecLinuxPlugin instance owning the parallel executor.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_native_eval_columns(ParsecLinuxPlugin* self,
+                                                           FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *text_value = fl_value_lookup_string(args, "equation");
+    FlValue *columns_value = fl_value_lookup_string(args, "columns");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, text_value)) return;
+    if (!parsec_linux_plugin_check_valid_input(method_call, columns_value, FL_VALUE_TYPE_MAP)) return;
+
+    vector<string> variable_names;
+    vector<const double*> columns;
+    size_t rows = 0;
+    size_t column_count = fl_value_get_length(columns_value);
+    for (size_t i = 0; i < column_count; i++) {
+        FlValue *name_value = fl_value_get_map_key(columns_value, i);
+        FlValue *column_value = fl_value_get_map_value(columns_value, i);
+        if (!parsec_linux_plugin_check_valid_input(method_call, name_value)) return;
+        if (!parsec_linux_plugin_check_valid_input(method_call, column_value, FL_VALUE_TYPE_FLOAT_LIST)) return;
+
+        size_t length = fl_value_get_length(column_value);
+        if (i > 0 && length != rows) {
+            g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+                "invalid_columns", "All columns must have the same length", nullptr));
+            parsec_linux_plugin_respond(method_call, response);
+            return;
+        }
+        rows = length;
+        variable_names.push_back(fl_value_get_string(name_value));
+        columns.push_back(fl_value_get_float_list(column_value));
+    }
+
+    EvalStats &stats = parsec_linux::GlobalEvalStats();
+    stats.RecordCall(strlen(fl_value_get_string(text_value)) + rows * columns.size() * sizeof(double));
+
+    g_autoptr(FlMethodResponse) response = nullptr;
+    try {
+        uint64_t start = parsec_linux::MonotonicNanos();
+        CompiledFormula formula(fl_value_get_string(text_value), variable_names, true);
+        uint64_t parsed = parsec_linux::MonotonicNanos();
+        stats.RecordPhase(EvalPhase::kParse, parsed - start);
+        parsec_linux_plugin_record_optimization(stats, formula);
+
+        // The FlValue lists copy the results, so they only live in the thread arena meanwhile.
+        parsec_linux::EvalArenaScope scope;
+        parsec_linux::ArenaVector<double> values(rows);
+        parsec_linux::ArenaVector<uint8_t> errors((rows + 7) / 8, 0);
+        if (rows >= kParallelMinRows && self->parallel->threads() > 1) {
+            parsec_linux::EvaluateColumnsParallel(*self->parallel, formula, columns.data(), rows,
+                                                  values.data(), errors.data());
+        } else {
+            formula.EvaluateColumns(columns.data(), rows, values.data(), errors.data());
+        }
+        stats.RecordPhase(EvalPhase::kEvaluate, parsec_linux::MonotonicNanos() - parsed);
+
+        g_autoptr(FlValue) result = fl_value_new_map();
+        fl_value_set_string_take(result, "values", fl_value_new_float_list(values.data(), rows));
+        fl_value_set_string_take(result, "errors", fl_value_new_uint8_list(errors.data(), errors.size()));
+        stats.RecordBytesOut(rows * sizeof(double) + errors.size());
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } catch (mup::ParserError &error) {
+        stats.RecordError();
+        response = FL_METHOD_RESPONSE(
+            fl_method_error_response_new("compile_error", error.GetMsg().c_str(), nullptr));
+    }
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the nativeCompile method call.
+
+Parses the "formula" argument once, binding the names of the "variables" list argument as its
+variables, and registers it in the plugin instance. The response is the id to evaluate it with, or
+a "compile_error" error response when the formula is invalid.
+
+@param[in] self The ParsecLinuxPlugin instance owning the compiled formulas.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_native_compile(ParsecLinuxPlugin* self,
+                                                      FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *text_value = fl_value_lookup_string(args, "formula");
+    FlValue *variables_value = fl_value_lookup_string(args, "variables");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, text_value)) return;
+    if (!parsec_linux_plugin_check_valid_input(method_call, variables_value, FL_VALUE_TYPE_LIST)) return;
+
+    vector<string> variable_names;
+    size_t length = fl_value_get_length(variables_value);
+    for (size_t i = 0; i < length; i++) {
+        FlValue *name_value = fl_value_get_list_value(variables_value, i);
+        if (!parsec_linux_plugin_check_valid_input(method_call, name_value)) return;
+        variable_names.push_back(fl_value_get_string(name_value));
+    }
+
+    EvalStats &stats = parsec_linux::GlobalEvalStats();
+    stats.RecordCall(strlen(fl_value_get_string(text_value)));
+
+    g_autoptr(FlMethodResponse) response = nullptr;
+    try {
+        uint64_t start = parsec_linux::MonotonicNanos();
+        auto formula = make_shared<CompiledFormula>(fl_value_get_string(text_value), variable_names, true);
+        stats.RecordPhase(EvalPhase::kParse, parsec_linux::MonotonicNanos() - start);
+        parsec_linux_plugin_record_optimization(stats, *formula);
+
+        g_autoptr(FlValue) result = fl_value_new_int(self->formulas->Add(std::move(formula)));
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } catch (mup::ParserError &error) {
+        stats.RecordError();
+        response = FL_METHOD_RESPONSE(
+            fl_method_error_response_new("compile_error", error.GetMsg().c_str(), nullptr));
+    }
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the nativeEvaluate method call.
+
+Evaluates the formula registered under the "id" argument with the "values" list argument bound to
+its variables, in the order they were given to nativeCompile. The response is a typed
+{"val": ..., "error": ...} map.
+
+@param[in] self The ParsecLinuxPlugin instance owning the compiled formulas.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_native_evaluate(ParsecLinuxPlugin* self,
+                                                       FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *id_value = fl_value_lookup_string(args, "id");
+    FlValue *values_value = fl_value_lookup_string(args, "values");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, id_value, FL_VALUE_TYPE_INT)) return;
+    if (!parsec_linux_plugin_check_valid_input(method_call, values_value, FL_VALUE_TYPE_LIST)) return;
+
+    EvalStats &stats = parsec_linux::GlobalEvalStats();
+    stats.RecordCall(fl_value_get_length(values_value) * sizeof(double));
+
+    g_autoptr(FlValue) result = nullptr;
+    shared_ptr<CompiledFormula> formula = self->formulas->Find(fl_value_get_int(id_value));
+    if (formula == nullptr) {
+        result = parsec_linux_plugin_typed_result_new(nullptr, "Unknown formula id");
+    } else if (fl_value_get_length(values_value) != formula->variable_names().size()) {
+        result = parsec_linux_plugin_typed_result_new(nullptr, "Wrong number of variable values");
+    } else {
+        lock_guard<mutex> lock(formula->mutex());
+        const gchar *error = nullptr;
+        for (size_t i = 0; i < formula->variable_names().size() && error == nullptr; i++) {
+            if (!parsec_linux_plugin_value_from_fl(fl_value_get_list_value(values_value, i),
+                                                   &formula->variable(i))) {
+                error = "Unsupported variable value type";
+            }
+        }
+
+        if (error != nullptr) {
+            result = parsec_linux_plugin_typed_result_new(nullptr, error);
+        } else {
+            try {
+                uint64_t start = parsec_linux::MonotonicNanos();
+                const mup::IValue &value = formula->Evaluate();
+                uint64_t evaluated = parsec_linux::MonotonicNanos();
+                stats.RecordPhase(EvalPhase::kEvaluate, evaluated - start);
+
+                result = parsec_linux_plugin_typed_result_new(parsec_linux_plugin_value_to_fl(value), nullptr);
+                stats.RecordPhase(EvalPhase::kSerialize, parsec_linux::MonotonicNanos() - evaluated);
+                stats.RecordBytesOut(parsec_linux_plugin_value_size(value));
+            } catch (mup::ParserError &error) {
+                result = parsec_linux_plugin_typed_result_new(nullptr, error.GetMsg().c_str());
+            }
+        }
+    }
+    // Every failure above, whatever its cause, leaves its message in the "error" entry.
+    if (fl_value_get_type(fl_value_lookup_string(result, "error")) != FL_VALUE_TYPE_NULL) {
+        stats.RecordError();
+    }
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the nativeDispose method call.
+
+Frees the formula registered under the "id" argument. The response is false if there was none.
+
+@param[in] self The ParsecLinuxPlugin instance owning the compiled formulas.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_native_dispose(ParsecLinuxPlugin* self,
+                                                      FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *id_value = fl_value_lookup_string(args, "id");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, id_value, FL_VALUE_TYPE_INT)) return;
+
+    g_autoptr(FlValue) result = fl_value_new_bool(self->formulas->Remove(fl_value_get_int(id_value)));
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the createSheet method call.
+
+Creates an empty formula sheet owned by this plugin instance and sends back its id.
+
+@param[in] self The ParsecLinuxPlugin instance owning the sheets.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_create_sheet(ParsecLinuxPlugin* self,
+                                                    FlMethodCall* method_call) {
+    int64_t id = self->sheets->Add(make_shared<FormulaSheet>());
+
+    g_autoptr(FlValue) result = fl_value_new_int(id);
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the updateSheet method call.
+
+Changes the cells of the sheet under the "id" argument, removing the cells named in the optional
+"remove" list, then setting the formulas of the optional "formulas" map and the values of the
+optional "values" map, both keyed by cell name. The sheet then recalculates the cells affected by
+the changes only.
+
+The response maps the name of every cell whose value or error changed to a typed
+{"val": ..., "error": ...} result. Invalid and circular formulas only put their cell in error.
+
+@param[in] self The ParsecLinuxPlugin instance owning the sheets.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_update_sheet(ParsecLinuxPlugin* self,
+                                                    FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *id_value = fl_value_lookup_string(args, "id");
+    FlValue *remove_value = fl_value_lookup_string(args, "remove");
+    FlValue *formulas_value = fl_value_lookup_string(args, "formulas");
+    FlValue *values_value = fl_value_lookup_string(args, "values");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, id_value, FL_VALUE_TYPE_INT)) return;
+
+    shared_ptr<FormulaSheet> sheet = self->sheets->Find(fl_value_get_int(id_value));
+    if (sheet == nullptr) {
+        g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "unknown_sheet", "Unknown sheet id", nullptr));
+        parsec_linux_plugin_respond(method_call, response);
+        return;
+    }
+
+    lock_guard<mutex> lock(sheet->mutex());
+    if (remove_value != nullptr && fl_value_get_type(remove_value) == FL_VALUE_TYPE_LIST) {
+        for (size_t i = 0; i < fl_value_get_length(remove_value); i++) {
+            FlValue *name_value = fl_value_get_list_value(remove_value, i);
+            if (fl_value_get_type(name_value) != FL_VALUE_TYPE_STRING) continue;
+            sheet->Remove(fl_value_get_string(name_value));
+        }
+    }
+    if (formulas_value != nullptr && fl_value_get_type(formulas_value) == FL_VALUE_TYPE_MAP) {
+        for (size_t i = 0; i < fl_value_get_length(formulas_value); i++) {
+            FlValue *name_value = fl_value_get_map_key(formulas_value, i);
+            FlValue *formula_value = fl_value_get_map_value(formulas_value, i);
+            if (fl_value_get_type(name_value) != FL_VALUE_TYPE_STRING ||
+                fl_value_get_type(formula_value) != FL_VALUE_TYPE_STRING) {
+                continue;
+            }
+            sheet->SetFormula(fl_value_get_string(name_value), fl_value_get_string(formula_value));
+        }
+    }
+    if (values_value != nullptr && fl_value_get_type(values_value) == FL_VALUE_TYPE_MAP) {
+        for (size_t i = 0; i < fl_value_get_length(values_value); i++) {
+            FlValue *name_value = fl_value_get_map_key(values_value, i);
+            mup::Value value;
+            if (fl_value_get_type(name_value) != FL_VALUE_TYPE_STRING ||
+                !parsec_linux_plugin_value_from_fl(fl_value_get_map_value(values_value, i), &value)) {
+                continue;
+            }
+            sheet->SetValue(fl_value_get_string(name_value), value);
+        }
+    }
+
+    g_autoptr(FlValue) result = fl_value_new_map();
+    for (const FormulaSheet::Change &change : sheet->Recalculate()) {
+        fl_value_set_string_take(
+            result, change.name.c_str(),
+            change.error.empty()
+                ? parsec_linux_plugin_typed_result_new(parsec_linux_plugin_value_to_fl(change.value), nullptr)
+                : parsec_linux_plugin_typed_result_new(nullptr, change.error.c_str()));
+    }
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the disposeSheet method call.
+
+Frees the sheet under the "id" argument. Sends back true if there was one.
+
+@param[in] self The ParsecLinuxPlugin instance owning the sheets.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_dispose_sheet(ParsecLinuxPlugin* self,
+                                                     FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *id_value = fl_value_lookup_string(args, "id");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, id_value, FL_VALUE_TYPE_INT)) return;
+
+    g_autoptr(FlValue) result = fl_value_new_bool(self->sheets->Remove(fl_value_get_int(id_value)));
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the setCacheCapacity method call.
+
+Changes how many parsed formulas the plugin formula cache keeps to the "capacity" argument, and each
+of its shards used by the split evaluations. A capacity of 0 disables the cache.
+
+@param[in] self The ParsecLinuxPlugin instance owning the formula cache.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_set_cache_capacity(ParsecLinuxPlugin* self,
+                                                          FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *capacity_value = fl_value_lookup_string(args, "capacity");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, capacity_value, FL_VALUE_TYPE_INT)) return;
+
+    int64_t capacity = fl_value_get_int(capacity_value);
+    self->cache->SetCapacity(capacity > 0 ? (size_t) capacity : 0);
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the getCacheStats method call.
+
+Sends back the hit, miss and eviction counts of the plugin formula cache, with its current size and
+capacity, the counts and size of the shards used by the split evaluations included.
+
+@param[in] self The ParsecLinuxPlugin instance owning the formula cache.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_get_cache_stats(ParsecLinuxPlugin* self,
+                                                       FlMethodCall* method_call) {
+    FormulaCacheStats stats = self->cache->stats();
+
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "hits", fl_value_new_int(stats.hits));
+    fl_value_set_string_take(result, "misses", fl_value_new_int(stats.misses));
+    fl_value_set_string_take(result, "evictions", fl_value_new_int(stats.evictions));
+    fl_value_set_string_take(result, "size", fl_value_new_int(stats.size));
+    fl_value_set_string_take(result, "capacity", fl_value_new_int(stats.capacity));
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the getStats method call.
+
+Sends back the process-wide evaluation counters: the number of calls and errors, the bytes received
+and sent, the number of formulas the optimizer rewrote with the RPN nodes it removed and of formulas
+running on the numeric engine, the chunks and bytes the evaluation arenas hold and the requests too
+large for their chunks, and for each of the "parse", "evaluate" and "serialize" phases its count,
+total and maximum time in nanoseconds and a log2 latency histogram as an Int64List, where bucket i
+counts the times in [2^(i-1), 2^i) ns.
+
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_get_stats(FlMethodCall* method_call) {
+    static const char* const kPhaseNames[parsec_linux::kEvalPhaseCount] = {
+        "parse", "evaluate", "serialize"};
+
+    EvalStatsSnapshot stats = parsec_linux::GlobalEvalStats().Snapshot();
+
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "calls", fl_value_new_int(stats.calls));
+    fl_value_set_string_take(result, "errors", fl_value_new_int(stats.errors));
+    fl_value_set_string_take(result, "bytesIn", fl_value_new_int(stats.bytes_in));
+    fl_value_set_string_take(result, "bytesOut", fl_value_new_int(stats.bytes_out));
+
+    FlValue *optimizer_value = fl_value_new_map();
+    fl_value_set_string_take(optimizer_value, "formulas", fl_value_new_int(stats.optimized_formulas));
+    fl_value_set_string_take(optimizer_value, "nodesRemoved", fl_value_new_int(stats.nodes_removed));
+    fl_value_set_string_take(optimizer_value, "numericFormulas", fl_value_new_int(stats.numeric_formulas));
+    fl_value_set_string_take(result, "optimizer", optimizer_value);
+
+    FlValue *arena_value = fl_value_new_map();
+    fl_value_set_string_take(arena_value, "chunks", fl_value_new_int(stats.arena_chunks));
+    fl_value_set_string_take(arena_value, "bytes", fl_value_new_int(stats.arena_bytes));
+    fl_value_set_string_take(arena_value, "oversized", fl_value_new_int(stats.arena_oversized));
+    fl_value_set_string_take(result, "arena", arena_value);
+    for (size_t i = 0; i < parsec_linux::kEvalPhaseCount; i++) {
+        const parsec_linux::EvalPhaseStats &phase = stats.phases[i];
+        FlValue *phase_value = fl_value_new_map();
+        fl_value_set_string_take(phase_value, "count", fl_value_new_int(phase.count));
+        fl_value_set_string_take(phase_value, "totalNs", fl_value_new_int(phase.total_ns));
+        fl_value_set_string_take(phase_value, "maxNs", fl_value_new_int(phase.max_ns));
+        fl_value_set_string_take(phase_value, "histogram", fl_value_new_int64_list(
+            reinterpret_cast<const int64_t*>(phase.histogram.data()), phase.histogram.size()));
+        fl_value_set_string_take(result, kPhaseNames[i], phase_value);
+    }
 
-    g_autofree gchar *answer = g_strdup_printf("%s", ans.c_str());
-    g_autoptr(FlValue) result = fl_value_new_string(answer);
     g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-    fl_method_call_respond(method_call, response, nullptr);
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the resetStats method call.
+
+Sets every evaluation counter back to zero.
+
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_reset_stats(FlMethodCall* method_call) {
+    parsec_linux::GlobalEvalStats().Reset();
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+static void parsec_linux_plugin_run_evaluation(gpointer data, gpointer user_data);
+
+/**
+ * @self: the ParsecLinuxPlugin the workers evaluate method calls for
+ * @pool_size: the number of worker threads
+ *
+ * Creates the worker pool running the evaluation methods off the platform thread.
+ */
+static GThreadPool* parsec_linux_plugin_new_workers(ParsecLinuxPlugin* self, gint pool_size) {
+    return g_thread_pool_new(parsec_linux_plugin_run_evaluation, self, pool_size, FALSE, nullptr);
+}
+
+/**
+ * @workers: the worker pool to free
+ *
+ * Frees the worker pool once every queued evaluation has run.
+ */
+static void parsec_linux_plugin_free_workers(GThreadPool* workers) {
+    g_thread_pool_free(workers, FALSE, TRUE);
+}
+
+struct ParsecLinuxRetiredWorkers {
+  ParsecLinuxPlugin* self;
+  GThreadPool* workers;
+};
+
+/**
+ * @user_data: the ParsecLinuxPlugin a retired worker pool evaluated method calls for
+ *
+ * Drops the reference the retired pool held, on the platform thread so a last reference disposes
+ * the plugin there.
+ */
+static gboolean parsec_linux_plugin_release_retired(gpointer user_data) {
+    g_object_unref(user_data);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * @data: the ParsecLinuxRetiredWorkers to free
+ *
+ * Runs on a helper thread until every evaluation queued on the retired pool has run.
+ */
+static gpointer parsec_linux_plugin_drain_workers(gpointer data) {
+    ParsecLinuxRetiredWorkers* retired = static_cast<ParsecLinuxRetiredWorkers*>(data);
+    parsec_linux_plugin_free_workers(retired->workers);
+    g_main_context_invoke(nullptr, parsec_linux_plugin_release_retired, retired->self);
+    g_free(retired);
+    return nullptr;
+}
+
+/**
+ * @self: the ParsecLinuxPlugin the workers evaluate method calls for
+ * @workers: the worker pool to free
+ *
+ * Frees the worker pool once every queued evaluation has run, without making the platform thread
+ * wait for them: a helper thread waits instead, keeping the plugin alive meanwhile.
+ */
+static void parsec_linux_plugin_retire_workers(ParsecLinuxPlugin* self, GThreadPool* workers) {
+    ParsecLinuxRetiredWorkers* retired = g_new(ParsecLinuxRetiredWorkers, 1);
+    retired->self = PARSEC_LINUX_PLUGIN(g_object_ref(self));
+    retired->workers = workers;
+    g_thread_unref(g_thread_new("parsec-retire", parsec_linux_plugin_drain_workers, retired));
+}
+
+/**
+
+@brief Handles the configureWorkerPool method call.
+
+Changes the number of worker threads running evaluations to the "poolSize" argument, 0 meaning the
+evaluations run synchronously on the platform thread, and how many evaluations may wait for a free
+worker to the "maxQueueDepth" argument, and how many threads split a large batch or columns
+evaluation to the "parallelism" argument, 1 disabling the splitting. All arguments are optional. The
+response is the resulting {"poolSize": ..., "maxQueueDepth": ..., "parallelism": ...} configuration,
+or an "invalid_argument" error, changing nothing, if "poolSize" is negative or "maxQueueDepth" or
+"parallelism" is not positive.
+
+@param[in] self The ParsecLinuxPlugin instance owning the worker pool.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_configure_worker_pool(ParsecLinuxPlugin* self,
+                                                             FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *pool_size_value = fl_value_lookup_string(args, "poolSize");
+    FlValue *max_queue_depth_value = fl_value_lookup_string(args, "maxQueueDepth");
+    FlValue *parallelism_value = fl_value_lookup_string(args, "parallelism");
+
+    auto below = [](FlValue *value, int64_t minimum) {
+        return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT &&
+               fl_value_get_int(value) < minimum;
+    };
+    if (below(pool_size_value, 0) || below(max_queue_depth_value, 1) ||
+        below(parallelism_value, 1)) {
+        g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "invalid_argument",
+            "poolSize must not be negative, maxQueueDepth and parallelism must be positive", nullptr));
+        parsec_linux_plugin_respond(method_call, response);
+        return;
+    }
+
+    if (pool_size_value != nullptr && fl_value_get_type(pool_size_value) == FL_VALUE_TYPE_INT) {
+        int64_t pool_size = fl_value_get_int(pool_size_value);
+        if (pool_size == 0) {
+            if (self->workers != nullptr) {
+                // The queued evaluations still run, their responses posted to the main context
+                parsec_linux_plugin_retire_workers(self, self->workers);
+                self->workers = nullptr;
+            }
+        } else if (self->workers == nullptr) {
+            self->workers = parsec_linux_plugin_new_workers(self, (gint) pool_size);
+        } else {
+            g_thread_pool_set_max_threads(self->workers, (gint) pool_size, nullptr);
+        }
+    }
+    if (max_queue_depth_value != nullptr && fl_value_get_type(max_queue_depth_value) == FL_VALUE_TYPE_INT) {
+        self->max_queue_depth = (guint) MIN(fl_value_get_int(max_queue_depth_value), G_MAXUINT);
+    }
+    if (parallelism_value != nullptr && fl_value_get_type(parallelism_value) == FL_VALUE_TYPE_INT) {
+        int64_t parallelism = fl_value_get_int(parallelism_value);
+        // Applied by the next split evaluation, never waiting for the one in progress
+        self->parallel->SetThreads((size_t) parallelism);
+    }
+
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "poolSize", fl_value_new_int(
+        self->workers != nullptr ? g_thread_pool_get_max_threads(self->workers) : 0));
+    fl_value_set_string_take(result, "maxQueueDepth", fl_value_new_int(self->max_queue_depth));
+    fl_value_set_string_take(result, "parallelism", fl_value_new_int(self->parallel->threads()));
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+struct ParsecLinuxPendingEvent {
+  FlEventChannel* channel;
+  FlValue* event;
+  // The evaluation stream the event carries results of, if any, and how many.
+  shared_ptr<EvalStream> stream;
+  size_t count;
+};
+
+/**
+ * @user_data: the ParsecLinuxPendingEvent to send
+ *
+ * Sends an event on the platform thread and frees it. For a stream event, gives the credits of
+ * its results back to the stream, and drops the event if the stream was closed meanwhile.
+ */
+static gboolean parsec_linux_plugin_send_event(gpointer user_data) {
+    ParsecLinuxPendingEvent* pending = static_cast<ParsecLinuxPendingEvent*>(user_data);
+
+    if (pending->stream == nullptr || !pending->stream->closed()) {
+        // Fails when Dart is not listening; the stream cancel handler then closes the streams
+        fl_event_channel_send(pending->channel, pending->event, nullptr, nullptr);
+    }
+    if (pending->stream != nullptr) pending->stream->Deliver(pending->count);
+
+    g_object_unref(pending->channel);
+    fl_value_unref(pending->event);
+    delete pending;
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * @channel: the FlEventChannel to send @event on
+ * @event: the event to send, taken
+ * @stream: the evaluation stream @event carries @count results of, or nullptr
+ * @count: the number of results of @stream in @event
+ *
+ * Sends @event from any thread, posting it to the main context like parsec_linux_plugin_respond().
+ */
+static void parsec_linux_plugin_post_event(FlEventChannel* channel, FlValue* event,
+                                           shared_ptr<EvalStream> stream = nullptr,
+                                           size_t count = 0) {
+    ParsecLinuxPendingEvent* pending = new ParsecLinuxPendingEvent();
+    pending->channel = static_cast<FlEventChannel*>(g_object_ref(channel));
+    pending->event = event;
+    pending->stream = std::move(stream);
+    pending->count = count;
+
+    g_main_context_invoke(nullptr, parsec_linux_plugin_send_event, pending);
+}
+
+/**
+ * @self: the ParsecLinuxPlugin owning the formula cache and the stream event channel
+ * @stream: the evaluation stream to drain
+ *
+ * Evaluates the formulas queued on @stream in order, including the ones pushed meanwhile, and
+ * posts their typed {"val": ..., "error": ...} results to the platform thread as
+ * {"id": ..., "results": [...]} events, until the queue is empty or the stream is closed.
+ */
+static void parsec_linux_plugin_drain_stream(ParsecLinuxPlugin* self,
+                                             const shared_ptr<EvalStream> &stream) {
+    vector<string> formulas;
+    while (stream->Take(&formulas, kStreamEventMaxLength)) {
+        FlValue *results = fl_value_new_list();
+        for (const string &formula : formulas) {
+            fl_value_append_take(results, parsec_linux_plugin_calc_typed(*self->cache, formula));
+        }
+
+        FlValue *event = fl_value_new_map();
+        fl_value_set_string_take(event, "id", fl_value_new_int(stream->id()));
+        fl_value_set_string_take(event, "results", results);
+        parsec_linux_plugin_post_event(self->stream_channel, event, stream, formulas.size());
+    }
+}
+
+/**
+ * @data: a heap-allocated shared_ptr to the EvalStream to drain, freed here
+ * @user_data: the ParsecLinuxPlugin owning the stream workers
+ *
+ * Stream worker pool function draining an evaluation stream on a worker thread.
+ */
+static void parsec_linux_plugin_run_stream(gpointer data, gpointer user_data) {
+    shared_ptr<EvalStream>* stream = static_cast<shared_ptr<EvalStream>*>(data);
+    parsec_linux_plugin_drain_stream(PARSEC_LINUX_PLUGIN(user_data), *stream);
+    delete stream;
+}
+
+/**
+ * @self: the ParsecLinuxPlugin owning the evaluation streams
+ * @method_call: the FlMethodCall to respond to
+ * @args: the FlValue map of arguments sent by the Dart code
+ * @stream: set to the stream named by the "id" argument
+ *
+ * Looks up the evaluation stream named by the "id" argument. If there is none, responds to
+ * @method_call with an "unknown_stream" error and returns false.
+ */
+static bool parsec_linux_plugin_find_stream(ParsecLinuxPlugin* self, FlMethodCall* method_call,
+                                            FlValue *args, shared_ptr<EvalStream> *stream) {
+    FlValue *id_value = fl_value_lookup_string(args, "id");
+    if (!parsec_linux_plugin_check_valid_input(method_call, id_value, FL_VALUE_TYPE_INT)) return false;
+
+    *stream = self->streams->Find(fl_value_get_int(id_value));
+    if (*stream == nullptr) {
+        g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "unknown_stream", "No evaluation stream is open with this id", nullptr));
+        parsec_linux_plugin_respond(method_call, response);
+        return false;
+    }
+    return true;
+}
+
+/**
+
+@brief Handles the openEvalStream method call.
+
+Opens a streaming evaluation and responds with its id. The optional "maxInFlight" argument sets its
+credits, how many formulas may be pushed before their results are delivered, 64 by default.
+
+@param[in] self The ParsecLinuxPlugin instance owning the evaluation streams.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_open_eval_stream(ParsecLinuxPlugin* self,
+                                                        FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *credits_value = fl_value_lookup_string(args, "maxInFlight");
+
+    size_t credits = kDefaultStreamCredits;
+    if (credits_value != nullptr && fl_value_get_type(credits_value) == FL_VALUE_TYPE_INT) {
+        credits = (size_t) clamp<int64_t>(fl_value_get_int(credits_value), 1, kMaxStreamCredits);
+    }
+
+    shared_ptr<EvalStream> stream = self->streams->Open(credits);
+
+    g_autoptr(FlValue) result = fl_value_new_int(stream->id());
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+
+@brief Handles the pushEvalStream method call.
+
+Queues the "equations" list argument on the evaluation stream named by the "id" argument and
+responds right away; their results follow on the "parsec_linux/eval_stream" event channel, in push
+order. A push that would leave more formulas in flight than the stream credits is rejected with a
+"stream_full" error, none of its equations being queued.
+
+The stream is drained on the stream workers, or on the platform thread when the worker pool is
+disabled.
+
+@param[in] self The ParsecLinuxPlugin instance owning the evaluation streams.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_push_eval_stream(ParsecLinuxPlugin* self,
+                                                        FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *list_value = fl_value_lookup_string(args, "equations");
+
+    shared_ptr<EvalStream> stream;
+    if (!parsec_linux_plugin_find_stream(self, method_call, args, &stream)) return;
+    if (!parsec_linux_plugin_check_valid_input(method_call, list_value, FL_VALUE_TYPE_LIST)) return;
+
+    size_t length = fl_value_get_length(list_value);
+    vector<string> formulas;
+    formulas.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        FlValue *text_value = fl_value_get_list_value(list_value, i);
+        if (!parsec_linux_plugin_check_valid_input(method_call, text_value)) return;
+        formulas.emplace_back(fl_value_get_string(text_value));
+    }
+
+    bool start_drain = false;
+    if (!stream->Push(std::move(formulas), &start_drain)) {
+        g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "stream_full", "Too many formulas are in flight on this evaluation stream", nullptr));
+        parsec_linux_plugin_respond(method_call, response);
+        return;
+    }
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    parsec_linux_plugin_respond(method_call, response);
+
+    if (!start_drain) return;
+    if (self->workers == nullptr) {
+        parsec_linux_plugin_drain_stream(self, stream);
+    } else {
+        g_thread_pool_push(self->stream_workers, new shared_ptr<EvalStream>(stream), nullptr);
+    }
+}
+
+/**
+
+@brief Handles the closeEvalStream method call.
+
+Closes the evaluation stream named by the "id" argument, dropping its formulas not evaluated yet
+and the results not delivered yet.
+
+@param[in] self The ParsecLinuxPlugin instance owning the evaluation streams.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_close_eval_stream(ParsecLinuxPlugin* self,
+                                                         FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *id_value = fl_value_lookup_string(args, "id");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, id_value, FL_VALUE_TYPE_INT)) return;
+
+    self->streams->Close(fl_value_get_int(id_value));
+
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    parsec_linux_plugin_respond(method_call, response);
+}
+
+/**
+ * @progress: the counters of a file evaluation
+ *
+ * Returns @progress as a {"lines": ..., "errors": ..., "bytesRead": ..., "bytesTotal": ...} map.
+ */
+static FlValue* parsec_linux_plugin_file_progress_to_fl(const FileEvalProgress &progress) {
+    FlValue *result = fl_value_new_map();
+    fl_value_set_string_take(result, "lines", fl_value_new_int((int64_t) progress.lines));
+    fl_value_set_string_take(result, "errors", fl_value_new_int((int64_t) progress.errors));
+    fl_value_set_string_take(result, "bytesRead", fl_value_new_int((int64_t) progress.bytes_read));
+    fl_value_set_string_take(result, "bytesTotal", fl_value_new_int((int64_t) progress.bytes_total));
+    return result;
+}
+
+/**
+
+@brief Handles the evalFile method call.
+
+Evaluates every line of the file at the "inputPath" argument as an equation, with the same results as
+CalcJson, and writes one record per line to the file at the "outputPath" argument: the CalcJson text
+and a newline, or a binary record when the "format" argument is "binary". The input is
+memory-mapped and evaluated in place, split across cores by the parallel executor, so the equations
+never cross the method channel.
+
+After each window of lines, the counters are sent on the "parsec_linux/eval_file" event channel,
+tagged with the "job" argument. The response holds the final
+{"lines": ..., "errors": ..., "bytesRead": ..., "bytesTotal": ...} counters, or a "file_error" if
+a file cannot be read or written.
+
+@param[in] self The ParsecLinuxPlugin instance owning the parallel executor.
+@param[in] method_call The FlMethodCall object representing the method call.
+*/
+static void parsec_linux_plugin_handle_eval_file(ParsecLinuxPlugin* self,
+                                                 FlMethodCall* method_call) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue *input_value = fl_value_lookup_string(args, "inputPath");
+    FlValue *output_value = fl_value_lookup_string(args, "outputPath");
+    FlValue *format_value = fl_value_lookup_string(args, "format");
+    FlValue *job_value = fl_value_lookup_string(args, "job");
+
+    if (!parsec_linux_plugin_check_valid_input(method_call, input_value)) return;
+    if (!parsec_linux_plugin_check_valid_input(method_call, output_value)) return;
+
+    FileRecordFormat format = FileRecordFormat::kJson;
+    if (format_value != nullptr && fl_value_get_type(format_value) == FL_VALUE_TYPE_STRING &&
+        strcmp(fl_value_get_string(format_value), "binary") == 0) {
+        format = FileRecordFormat::kBinary;
+    }
+    int64_t job = job_value != nullptr && fl_value_get_type(job_value) == FL_VALUE_TYPE_INT
+                      ? fl_value_get_int(job_value)
+                      : 0;
+
+    try {
+        // Lines of a file are mostly evaluated once, so they go through a cache of their own rather
+        // than evicting the formulas nativeEval keeps hot.
+        FormulaCache cache;
+        FileEvalProgress counters = parsec_linux::EvaluateFile(
+            fl_value_get_string(input_value), fl_value_get_string(output_value), format,
+            cache, *self->parallel, [self, job](const FileEvalProgress &progress) {
+                FlValue *event = parsec_linux_plugin_file_progress_to_fl(progress);
+                fl_value_set_string_take(event, "job", fl_value_new_int(job));
+                parsec_linux_plugin_post_event(self->file_channel, event);
+            });
+
+        g_autoptr(FlValue) result = parsec_linux_plugin_file_progress_to_fl(counters);
+        g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+        parsec_linux_plugin_respond(method_call, response);
+    } catch (system_error &error) {
+        g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(
+            fl_method_error_response_new("file_error", error.what(), nullptr));
+        parsec_linux_plugin_respond(method_call, response);
+    }
+}
+
+/**
+ * @brief Handles the method calls that evaluate formulas, on whichever thread runs them
+ *
+ * @param self Pointer to the ParsecLinuxPlugin object
+ * @param method_call FlMethodCall object containing the method call information
+ *
+ * Returns false if @p method_call is not an evaluation method, without responding to it.
+ */
+static bool parsec_linux_plugin_handle_evaluation(ParsecLinuxPlugin* self,
+                                                  FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+
+  if (strcmp(method, "nativeEval") == 0) {
+    parsec_linux_plugin_handle_native_eval(self, method_call);
+  } else if (strcmp(method, "nativeEvalBatch") == 0) {
+    parsec_linux_plugin_handle_native_eval_batch(self, method_call);
+  } else if (strcmp(method, "nativeEvalColumns") == 0) {
+    parsec_linux_plugin_handle_native_eval_columns(self, method_call);
+  } else if (strcmp(method, "nativeCompile") == 0) {
+    parsec_linux_plugin_handle_native_compile(self, method_call);
+  } else if (strcmp(method, "nativeEvaluate") == 0) {
+    parsec_linux_plugin_handle_native_evaluate(self, method_call);
+  } else if (strcmp(method, "evalFile") == 0) {
+    parsec_linux_plugin_handle_eval_file(self, method_call);
+  } else if (strcmp(method, "updateSheet") == 0) {
+    parsec_linux_plugin_handle_update_sheet(self, method_call);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @data: the FlMethodCall to evaluate, referenced when it was queued
+ * @user_data: the ParsecLinuxPlugin owning the worker pool
+ *
+ * Worker pool function evaluating a queued method call on a worker thread.
+ */
+static void parsec_linux_plugin_run_evaluation(gpointer data, gpointer user_data) {
+  FlMethodCall* method_call = static_cast<FlMethodCall*>(data);
+  if (!parsec_linux_plugin_handle_evaluation(PARSEC_LINUX_PLUGIN(user_data), method_call)) {
+    g_autoptr(FlMethodResponse) response = nullptr;
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    parsec_linux_plugin_respond(method_call, response);
+  }
+  g_object_unref(method_call);
 }
 
 /**
@@ -78,9 +1313,13 @@ static void parsec_linux_plugin_handle_native_eval(FlMethodCall* method_call) {
  * @param self Pointer to the ParsecLinuxPlugin object
  * @param method_call FlMethodCall object containing the method call information
  *
- * This function handles method calls from the dart side of the plugin. It checks if the method call
- * is "nativeEval" and if so, it calls the `handle_native_eval` function passing it the
- * `method_call` object.
+ * This function handles method calls from the dart side of the plugin. The evaluation methods
+ * ("nativeEval", "nativeEvalBatch", "nativeEvalColumns", "nativeCompile", "nativeEvaluate",
+ * "evalFile" and "updateSheet") are queued on the worker pool, so a slow formula does not stall the
+ * GTK main loop, or rejected with a "queue_full" error when too many are already waiting. The other
+ * methods ("nativeDispose", "createSheet", "disposeSheet", "setCacheCapacity", "getCacheStats",
+ * "configureWorkerPool" and the evaluation stream ones) are cheap and handled right away;
+ * evaluation streams are drained by their own workers.
  */
 static void parsec_linux_plugin_handle_method_call(
     ParsecLinuxPlugin* self,
@@ -88,12 +1327,40 @@ static void parsec_linux_plugin_handle_method_call(
 
   const gchar* method = fl_method_call_get_name(method_call);
 
-  if (strcmp(method, "nativeEval") == 0) {
-    parsec_linux_plugin_handle_native_eval(method_call);
+  if (strcmp(method, "nativeDispose") == 0) {
+    parsec_linux_plugin_handle_native_dispose(self, method_call);
+  } else if (strcmp(method, "createSheet") == 0) {
+    parsec_linux_plugin_handle_create_sheet(self, method_call);
+  } else if (strcmp(method, "disposeSheet") == 0) {
+    parsec_linux_plugin_handle_dispose_sheet(self, method_call);
+  } else if (strcmp(method, "setCacheCapacity") == 0) {
+    parsec_linux_plugin_handle_set_cache_capacity(self, method_call);
+  } else if (strcmp(method, "getCacheStats") == 0) {
+    parsec_linux_plugin_handle_get_cache_stats(self, method_call);
+  } else if (strcmp(method, "getStats") == 0) {
+    parsec_linux_plugin_handle_get_stats(method_call);
+  } else if (strcmp(method, "resetStats") == 0) {
+    parsec_linux_plugin_handle_reset_stats(method_call);
+  } else if (strcmp(method, "configureWorkerPool") == 0) {
+    parsec_linux_plugin_handle_configure_worker_pool(self, method_call);
+  } else if (strcmp(method, "openEvalStream") == 0) {
+    parsec_linux_plugin_handle_open_eval_stream(self, method_call);
+  } else if (strcmp(method, "pushEvalStream") == 0) {
+    parsec_linux_plugin_handle_push_eval_stream(self, method_call);
+  } else if (strcmp(method, "closeEvalStream") == 0) {
+    parsec_linux_plugin_handle_close_eval_stream(self, method_call);
+  } else if (self->workers == nullptr) {
+    if (!parsec_linux_plugin_handle_evaluation(self, method_call)) {
+      g_autoptr(FlMethodResponse) response = nullptr;
+      response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+      parsec_linux_plugin_respond(method_call, response);
+    }
+  } else if (g_thread_pool_unprocessed(self->workers) >= self->max_queue_depth) {
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "queue_full", "Too many evaluations are waiting for a worker", nullptr));
+    parsec_linux_plugin_respond(method_call, response);
   } else {
-    g_autoptr(FlMethodResponse) response = nullptr;
-    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
-    fl_method_call_respond(method_call, response, nullptr);
+    g_thread_pool_push(self->workers, g_object_ref(method_call), nullptr);
   }
 }
 
@@ -102,6 +1369,24 @@ static void parsec_linux_plugin_handle_method_call(
  * This function is called by the flutter linux plugin system during finalization.
  */
 static void parsec_linux_plugin_dispose(GObject* object) {
+  ParsecLinuxPlugin* self = PARSEC_LINUX_PLUGIN(object);
+  // Let the queued evaluations finish before freeing the state they use
+  g_clear_pointer(&self->workers, parsec_linux_plugin_free_workers);
+  self->streams->CloseAll();
+  g_clear_pointer(&self->stream_workers, parsec_linux_plugin_free_workers);
+  g_clear_object(&self->stream_channel);
+  g_clear_object(&self->file_channel);
+  delete self->streams;
+  self->streams = nullptr;
+  delete self->formulas;
+  self->formulas = nullptr;
+  delete self->sheets;
+  self->sheets = nullptr;
+  delete self->cache;
+  self->cache = nullptr;
+  delete self->parallel;
+  self->parallel = nullptr;
+
   G_OBJECT_CLASS(parsec_linux_plugin_parent_class)->dispose(object);
 }
 
@@ -112,10 +1397,37 @@ static void parsec_linux_plugin_class_init(ParsecLinuxPluginClass* klass) {
   G_OBJECT_CLASS(klass)->dispose = parsec_linux_plugin_dispose;
 }
 
+/**
+ * @data: the number of parsers to set up, as a pointer-sized integer
+ *
+ * Runs on a helper thread, setting up parsers in the process-wide parser pool, which outlives any
+ * plugin instance.
+ */
+static gpointer parsec_linux_plugin_prewarm_parsers(gpointer data) {
+    parsec_linux::GlobalParserPool().Prewarm(GPOINTER_TO_UINT(data));
+    return nullptr;
+}
+
 /**
  * Initialize an instance of the ParsecLinuxPlugin.
  */
-static void parsec_linux_plugin_init(ParsecLinuxPlugin* self) {}
+static void parsec_linux_plugin_init(ParsecLinuxPlugin* self) {
+  self->formulas = new FormulaRegistry();
+  self->sheets = new SheetRegistry();
+  self->cache = new FormulaCache();
+  self->workers = parsec_linux_plugin_new_workers(self, (gint) g_get_num_processors());
+  self->max_queue_depth = kDefaultMaxQueueDepth;
+  self->parallel = new ParallelExecutor(g_get_num_processors());
+  self->streams = new EvalStreamRegistry();
+  self->stream_channel = nullptr;
+  self->file_channel = nullptr;
+  self->stream_workers = g_thread_pool_new(parsec_linux_plugin_run_stream, self,
+                                           (gint) g_get_num_processors(), FALSE, nullptr);
+  // One parser per worker, so the first formulas compiled in parallel do not set them up. Set up on
+  // a helper thread: registration runs on the platform thread, which must not wait for them.
+  g_thread_unref(g_thread_new("parsec-prewarm", parsec_linux_plugin_prewarm_parsers,
+                              GUINT_TO_POINTER(g_get_num_processors())));
+}
 
 /**
  * @channel: A FlMethodChannel
@@ -131,12 +1443,28 @@ static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
   parsec_linux_plugin_handle_method_call(plugin, method_call);
 }
 
+/**
+ * @channel: the evaluation stream FlEventChannel
+ * @args: the arguments of the cancel call
+ * @user_data: the ParsecLinuxPlugin sending the stream events
+ *
+ * Callback triggered when Dart stops listening to the evaluation stream events: no result could be
+ * delivered anymore, so every open stream is closed.
+ */
+static FlMethodErrorResponse* stream_cancel_cb(FlEventChannel* channel, FlValue* args,
+                                               gpointer user_data) {
+  ParsecLinuxPlugin* plugin = PARSEC_LINUX_PLUGIN(user_data);
+  plugin->streams->CloseAll();
+  return nullptr;
+}
+
 /**
  * @registrar: A FlPluginRegistrar
  *
  * Responsible to register the ParsecLinuxPlugin in the flutter plugin ecosystem.
  * This will create a new instance of the plugin, set up a method channel,
- * and set the method call handler to the callback method_call_cb.
+ * and set the method call handler to the callback method_call_cb, along with the event channels
+ * the evaluation stream results and the file evaluation progress are sent on.
  */
 void parsec_linux_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
   ParsecLinuxPlugin* plugin = PARSEC_LINUX_PLUGIN(
@@ -151,5 +1479,15 @@ void parsec_linux_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
                                             g_object_ref(plugin),
                                             g_object_unref);
 
+  // Owned by the plugin, which its handlers do not reference to avoid a cycle
+  plugin->stream_channel = fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                                                "parsec_linux/eval_stream",
+                                                FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(plugin->stream_channel, nullptr, stream_cancel_cb,
+                                       plugin, nullptr);
+  plugin->file_channel = fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                                              "parsec_linux/eval_file",
+                                              FL_METHOD_CODEC(codec));
+
   g_object_unref(plugin);
 }
@@ -0,0 +1,188 @@
+#include "parsec_numeric_kernels.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PARSEC_LINUX_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace parsec_linux {
+
+namespace {
+
+/**
+ * Runs @in over the lanes [@begin, @count) one at a time, computing exactly what
+ * NumericProgram::Run() computes.
+ */
+void ExecuteScalar(const NumericInstruction &in, double *const *r, size_t begin, size_t count) {
+  const double *a = r[in.a];
+  const double *b = r[in.b];
+  const double *c = r[in.c];
+  double *dst = r[in.dst];
+  size_t i = begin;
+  switch (in.op) {
+    case NumericOp::kAdd: for (; i < count; i++) dst[i] = a[i] + b[i]; break;
+    case NumericOp::kSubtract: for (; i < count; i++) dst[i] = a[i] - b[i]; break;
+    case NumericOp::kMultiply: for (; i < count; i++) dst[i] = a[i] * b[i]; break;
+    case NumericOp::kDivide: for (; i < count; i++) dst[i] = a[i] / b[i]; break;
+    case NumericOp::kPower: for (; i < count; i++) dst[i] = pow(a[i], b[i]); break;
+    case NumericOp::kNegate: for (; i < count; i++) dst[i] = -a[i]; break;
+    case NumericOp::kEqual: for (; i < count; i++) dst[i] = a[i] == b[i]; break;
+    case NumericOp::kNotEqual: for (; i < count; i++) dst[i] = a[i] != b[i]; break;
+    case NumericOp::kLess: for (; i < count; i++) dst[i] = a[i] < b[i]; break;
+    case NumericOp::kGreater: for (; i < count; i++) dst[i] = a[i] > b[i]; break;
+    case NumericOp::kLessEqual: for (; i < count; i++) dst[i] = a[i] <= b[i]; break;
+    case NumericOp::kGreaterEqual: for (; i < count; i++) dst[i] = a[i] >= b[i]; break;
+    case NumericOp::kAnd: for (; i < count; i++) dst[i] = a[i] != 0 && b[i] != 0; break;
+    case NumericOp::kOr: for (; i < count; i++) dst[i] = a[i] != 0 || b[i] != 0; break;
+    case NumericOp::kSelect: for (; i < count; i++) dst[i] = a[i] != 0 ? b[i] : c[i]; break;
+    case NumericOp::kCall: for (; i < count; i++) dst[i] = in.function(a[i]); break;
+  }
+}
+
+#ifdef PARSEC_LINUX_X86
+
+// Stores EXPR, computed from the vectors va, vb and vc loaded at lane i, for each full vector of
+// WIDTH lanes. Lambdas would not inherit the target attribute of the kernel, so this is a macro.
+#define PARSEC_LINUX_VECTOR_LOOP(WIDTH, LOAD, STORE, EXPR) \
+  for (; i + (WIDTH) <= count; i += (WIDTH)) {             \
+    auto va = LOAD(a + i);                                 \
+    auto vb = LOAD(b + i);                                 \
+    auto vc = LOAD(c + i);                                 \
+    (void) va; (void) vb; (void) vc;                       \
+    STORE(dst + i, (EXPR));                                \
+  }
+
+__attribute__((target("sse2")))
+void ExecuteSse2(const NumericInstruction &in, double *const *r, size_t count) {
+  const double *a = r[in.a];
+  const double *b = r[in.b];
+  const double *c = r[in.c];
+  double *dst = r[in.dst];
+  const __m128d zero = _mm_setzero_pd();
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d sign = _mm_set1_pd(-0.0);
+  size_t i = 0;
+
+#define SSE2_LOOP(EXPR) PARSEC_LINUX_VECTOR_LOOP(2, _mm_loadu_pd, _mm_storeu_pd, EXPR)
+  switch (in.op) {
+    case NumericOp::kAdd: SSE2_LOOP(_mm_add_pd(va, vb)); break;
+    case NumericOp::kSubtract: SSE2_LOOP(_mm_sub_pd(va, vb)); break;
+    case NumericOp::kMultiply: SSE2_LOOP(_mm_mul_pd(va, vb)); break;
+    case NumericOp::kDivide: SSE2_LOOP(_mm_div_pd(va, vb)); break;
+    case NumericOp::kNegate: SSE2_LOOP(_mm_xor_pd(va, sign)); break;
+    case NumericOp::kEqual: SSE2_LOOP(_mm_and_pd(_mm_cmpeq_pd(va, vb), one)); break;
+    case NumericOp::kNotEqual: SSE2_LOOP(_mm_and_pd(_mm_cmpneq_pd(va, vb), one)); break;
+    case NumericOp::kLess: SSE2_LOOP(_mm_and_pd(_mm_cmplt_pd(va, vb), one)); break;
+    case NumericOp::kGreater: SSE2_LOOP(_mm_and_pd(_mm_cmpgt_pd(va, vb), one)); break;
+    case NumericOp::kLessEqual: SSE2_LOOP(_mm_and_pd(_mm_cmple_pd(va, vb), one)); break;
+    case NumericOp::kGreaterEqual: SSE2_LOOP(_mm_and_pd(_mm_cmpge_pd(va, vb), one)); break;
+    case NumericOp::kAnd:
+      SSE2_LOOP(_mm_and_pd(_mm_and_pd(_mm_cmpneq_pd(va, zero), _mm_cmpneq_pd(vb, zero)), one));
+      break;
+    case NumericOp::kOr:
+      SSE2_LOOP(_mm_and_pd(_mm_or_pd(_mm_cmpneq_pd(va, zero), _mm_cmpneq_pd(vb, zero)), one));
+      break;
+    case NumericOp::kSelect: {
+      // SSE2 has no blend: (mask & b) | (~mask & c).
+      SSE2_LOOP(_mm_or_pd(_mm_and_pd(_mm_cmpneq_pd(va, zero), vb),
+                          _mm_andnot_pd(_mm_cmpneq_pd(va, zero), vc)));
+      break;
+    }
+    default:
+      // pow() and builtins go through libm, lane by lane.
+      break;
+  }
+#undef SSE2_LOOP
+
+  ExecuteScalar(in, r, i, count);
+}
+
+__attribute__((target("avx2")))
+void ExecuteAvx2(const NumericInstruction &in, double *const *r, size_t count) {
+  const double *a = r[in.a];
+  const double *b = r[in.b];
+  const double *c = r[in.c];
+  double *dst = r[in.dst];
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  size_t i = 0;
+
+#define AVX2_LOOP(EXPR) PARSEC_LINUX_VECTOR_LOOP(4, _mm256_loadu_pd, _mm256_storeu_pd, EXPR)
+#define AVX2_COMPARE(PREDICATE) AVX2_LOOP(_mm256_and_pd(_mm256_cmp_pd(va, vb, PREDICATE), one))
+  switch (in.op) {
+    case NumericOp::kAdd: AVX2_LOOP(_mm256_add_pd(va, vb)); break;
+    case NumericOp::kSubtract: AVX2_LOOP(_mm256_sub_pd(va, vb)); break;
+    case NumericOp::kMultiply: AVX2_LOOP(_mm256_mul_pd(va, vb)); break;
+    case NumericOp::kDivide: AVX2_LOOP(_mm256_div_pd(va, vb)); break;
+    case NumericOp::kNegate: AVX2_LOOP(_mm256_xor_pd(va, sign)); break;
+    // Ordered predicates are false on NaN and the unordered != is true, as the C++ operators are.
+    case NumericOp::kEqual: AVX2_COMPARE(_CMP_EQ_OQ); break;
+    case NumericOp::kNotEqual: AVX2_COMPARE(_CMP_NEQ_UQ); break;
+    case NumericOp::kLess: AVX2_COMPARE(_CMP_LT_OQ); break;
+    case NumericOp::kGreater: AVX2_COMPARE(_CMP_GT_OQ); break;
+    case NumericOp::kLessEqual: AVX2_COMPARE(_CMP_LE_OQ); break;
+    case NumericOp::kGreaterEqual: AVX2_COMPARE(_CMP_GE_OQ); break;
+    case NumericOp::kAnd:
+      AVX2_LOOP(_mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(va, zero, _CMP_NEQ_UQ),
+                                            _mm256_cmp_pd(vb, zero, _CMP_NEQ_UQ)), one));
+      break;
+    case NumericOp::kOr:
+      AVX2_LOOP(_mm256_and_pd(_mm256_or_pd(_mm256_cmp_pd(va, zero, _CMP_NEQ_UQ),
+                                           _mm256_cmp_pd(vb, zero, _CMP_NEQ_UQ)), one));
+      break;
+    case NumericOp::kSelect:
+      AVX2_LOOP(_mm256_blendv_pd(vc, vb, _mm256_cmp_pd(va, zero, _CMP_NEQ_UQ)));
+      break;
+    default:
+      // pow() and builtins go through libm, lane by lane.
+      break;
+  }
+#undef AVX2_COMPARE
+#undef AVX2_LOOP
+
+  ExecuteScalar(in, r, i, count);
+}
+
+#undef PARSEC_LINUX_VECTOR_LOOP
+
+#endif  // PARSEC_LINUX_X86
+
+}  // namespace
+
+SimdLevel DetectSimdLevel() {
+#ifdef PARSEC_LINUX_X86
+  static const SimdLevel level = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::kAvx2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::kSse2;
+    return SimdLevel::kScalar;
+  }();
+  return level;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+const char *SimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::kAvx2: return "avx2";
+    case SimdLevel::kSse2: return "sse2";
+    default: return "scalar";
+  }
+}
+
+void ExecuteBlock(SimdLevel level, const NumericInstruction &instruction, double *const *registers,
+                  size_t count) {
+#ifdef PARSEC_LINUX_X86
+  if (level == SimdLevel::kAvx2) return ExecuteAvx2(instruction, registers, count);
+  if (level == SimdLevel::kSse2) return ExecuteSse2(instruction, registers, count);
+#endif
+  ExecuteScalar(instruction, registers, 0, count);
+}
+
+}  // namespace parsec_linux
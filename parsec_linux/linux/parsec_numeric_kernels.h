@@ -0,0 +1,37 @@
+#ifndef PARSEC_LINUX_PARSEC_NUMERIC_KERNELS_H_
+#define PARSEC_LINUX_PARSEC_NUMERIC_KERNELS_H_
+
+#include <cstddef>
+
+#include "parsec_numeric_program.h"
+
+namespace parsec_linux {
+
+enum class SimdLevel {
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+/**
+ * @brief The widest instruction set the CPU supports, detected once.
+ */
+SimdLevel DetectSimdLevel();
+
+const char *SimdLevelName(SimdLevel level);
+
+/**
+ * @brief Runs @p instruction over @p count lanes, each register being a block of @p count doubles
+ * pointed to by @p registers.
+ *
+ * The arithmetic, comparison, logical and select operations use @p level vector instructions.
+ * They are exact IEEE operations, so every lane is bit-for-bit the scalar result; the kernels never
+ * fuse a multiply and an add, which would round differently. pow() and the builtins call the same
+ * scalar libm function per lane as the scalar path, so they are bit-for-bit identical too.
+ */
+void ExecuteBlock(SimdLevel level, const NumericInstruction &instruction, double *const *registers,
+                  size_t count);
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_NUMERIC_KERNELS_H_
@@ -0,0 +1,325 @@
+#include "parsec_numeric_program.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+#include "parsec_eval_arena.h"
+#include "parsec_expression.h"
+#include "parsec_numeric_kernels.h"
+
+using namespace std;
+
+namespace parsec_linux {
+
+namespace {
+
+// Bytes of register blocks RunColumns() keeps in flight, half of a typical 32 KiB L1 data cache
+// so the columns streaming through have room too.
+constexpr size_t kBlockBytes = 16 * 1024;
+// Bounds of the rows per block: enough to amortize the dispatch of each instruction, and a
+// multiple of the widest vector.
+constexpr size_t kMinBlockRows = 16;
+constexpr size_t kMaxBlockRows = 512;
+
+// Real builtins of one argument, bound to the libm function muparserx calls for them.
+const unordered_map<string, double (*)(double)> kRealFunctions = {
+    {"sin", [](double x) { return sin(x); }},
+    {"cos", [](double x) { return cos(x); }},
+    {"tan", [](double x) { return tan(x); }},
+    {"asin", [](double x) { return asin(x); }},
+    {"acos", [](double x) { return acos(x); }},
+    {"atan", [](double x) { return atan(x); }},
+    {"sinh", [](double x) { return sinh(x); }},
+    {"cosh", [](double x) { return cosh(x); }},
+    {"tanh", [](double x) { return tanh(x); }},
+    {"sqrt", [](double x) { return sqrt(x); }},
+    {"exp", [](double x) { return exp(x); }},
+    {"ln", [](double x) { return log(x); }},
+    {"log2", [](double x) { return log2(x); }},
+    {"log10", [](double x) { return log10(x); }},
+    {"abs", [](double x) { return fabs(x); }},
+};
+
+inline void Execute(const NumericInstruction &instruction, double *r) {
+  double a = r[instruction.a];
+  double b = r[instruction.b];
+  double &dst = r[instruction.dst];
+  switch (instruction.op) {
+    case NumericOp::kAdd: dst = a + b; break;
+    case NumericOp::kSubtract: dst = a - b; break;
+    case NumericOp::kMultiply: dst = a * b; break;
+    case NumericOp::kDivide: dst = a / b; break;
+    case NumericOp::kPower: dst = pow(a, b); break;
+    case NumericOp::kNegate: dst = -a; break;
+    case NumericOp::kEqual: dst = a == b; break;
+    case NumericOp::kNotEqual: dst = a != b; break;
+    case NumericOp::kLess: dst = a < b; break;
+    case NumericOp::kGreater: dst = a > b; break;
+    case NumericOp::kLessEqual: dst = a <= b; break;
+    case NumericOp::kGreaterEqual: dst = a >= b; break;
+    case NumericOp::kAnd: dst = a != 0 && b != 0; break;
+    case NumericOp::kOr: dst = a != 0 || b != 0; break;
+    case NumericOp::kSelect: dst = a != 0 ? b : r[instruction.c]; break;
+    case NumericOp::kCall: dst = instruction.function(a); break;
+  }
+}
+
+}  // namespace
+
+/**
+ * Lowers the expression graph of a formula into a NumericProgram, inferring the type of every
+ * subexpression on the way.
+ */
+class NumericCompiler {
+ public:
+  NumericCompiler(const ExprGraph &graph, const vector<string> &variable_names)
+      : graph_(graph), variable_names_(variable_names) {}
+
+  unique_ptr<NumericProgram> Compile(int root) {
+    program_.reset(new NumericProgram());
+    program_->registers_.assign(variable_names_.size(), 0.0);
+    program_->variable_count_ = variable_names_.size();
+
+    Operand result;
+    if (!Lower(root, &result)) return nullptr;
+    program_->result_ = result.reg;
+    program_->returns_bool_ = result.is_bool;
+    program_->may_return_int_ = result.may_be_int;
+    program_->int_variables_ = result.int_variables;
+    return std::move(program_);
+  }
+
+ private:
+  struct Operand {
+    uint32_t reg = 0;
+    bool is_bool = false;
+    bool is_constant = false;
+    // Whether muparserx types the value as an integer when every variable of int_variables, in
+    // increasing order, holds one.
+    bool may_be_int = false;
+    vector<uint32_t> int_variables;
+  };
+
+  static Operand Integer(Operand operand, vector<uint32_t> int_variables) {
+    operand.may_be_int = true;
+    operand.int_variables = std::move(int_variables);
+    return operand;
+  }
+
+  bool Lower(int id, Operand *operand) {
+    auto it = lowered_.find(id);
+    if (it != lowered_.end()) {
+      *operand = it->second;
+      return true;
+    }
+    if (!LowerNode(graph_.node(id), operand)) return false;
+    lowered_.emplace(id, *operand);
+    return true;
+  }
+
+  bool LowerNode(const ExprNode &n, Operand *operand) {
+    switch (n.kind) {
+      case ExprKind::kNumber: {
+        char *end = nullptr;
+        double value = strtod(n.text.c_str(), &end);
+        if (*end != '\0') return false;
+        *operand = Constant(value, false);
+        // Integer literals are integers, unlike those with a fraction or an exponent.
+        if (n.text.find_first_not_of("0123456789") == string::npos) {
+          *operand = Integer(*operand, {});
+        }
+        return true;
+      }
+      case ExprKind::kBoolean:
+        *operand = Constant(n.text == "true" ? 1.0 : 0.0, true);
+        return true;
+      case ExprKind::kName:
+        for (size_t i = 0; i < variable_names_.size(); i++) {
+          if (variable_names_[i] == n.text) {
+            *operand = Integer(Operand{static_cast<uint32_t>(i), false, false},
+                               {static_cast<uint32_t>(i)});
+            return true;
+          }
+        }
+        if (n.text == "pi") {
+          *operand = Constant(3.141592653589793238462643, false);
+          return true;
+        }
+        if (n.text == "e") {
+          *operand = Constant(2.718281828459045235360287, false);
+          return true;
+        }
+        return false;
+      case ExprKind::kUnary: {
+        Operand x;
+        if (!Lower(n.children[0], &x) || x.is_bool) return false;
+        *operand = Emit(NumericOp::kNegate, false, {x});
+        if (x.may_be_int) *operand = Integer(*operand, x.int_variables);
+        return true;
+      }
+      case ExprKind::kBinary:
+        return LowerBinary(n, operand);
+      case ExprKind::kTernary: {
+        Operand condition, then_branch, else_branch;
+        if (!Lower(n.children[0], &condition) || !condition.is_bool) return false;
+        if (!Lower(n.children[1], &then_branch) || !Lower(n.children[2], &else_branch)) return false;
+        if (then_branch.is_bool != else_branch.is_bool) return false;
+        *operand = Emit(NumericOp::kSelect, then_branch.is_bool, {condition, then_branch, else_branch});
+        if (then_branch.may_be_int != else_branch.may_be_int ||
+            then_branch.int_variables != else_branch.int_variables) {
+          // Integer or float depending on the branch taken.
+          program_->result_type_known_ = false;
+        } else if (then_branch.may_be_int) {
+          *operand = Integer(*operand, then_branch.int_variables);
+        }
+        return true;
+      }
+      case ExprKind::kCall:
+        return LowerCall(n, operand);
+      default:
+        // Strings and the factorial.
+        return false;
+    }
+  }
+
+  bool LowerBinary(const ExprNode &n, Operand *operand) {
+    static const unordered_map<string, NumericOp> kArithmetic = {
+        {"+", NumericOp::kAdd}, {"-", NumericOp::kSubtract}, {"*", NumericOp::kMultiply},
+        {"/", NumericOp::kDivide}, {"^", NumericOp::kPower}};
+    static const unordered_map<string, NumericOp> kComparisons = {
+        {"==", NumericOp::kEqual}, {"!=", NumericOp::kNotEqual}, {"<", NumericOp::kLess},
+        {">", NumericOp::kGreater}, {"<=", NumericOp::kLessEqual}, {">=", NumericOp::kGreaterEqual}};
+    static const unordered_map<string, NumericOp> kLogical = {
+        {"and", NumericOp::kAnd}, {"&&", NumericOp::kAnd}, {"or", NumericOp::kOr},
+        {"||", NumericOp::kOr}};
+
+    Operand left, right;
+    if (!Lower(n.children[0], &left) || !Lower(n.children[1], &right)) return false;
+
+    auto it = kArithmetic.find(n.text);
+    if (it != kArithmetic.end() || (it = kComparisons.find(n.text)) != kComparisons.end()) {
+      if (left.is_bool || right.is_bool) return false;
+      *operand = Emit(it->second, kComparisons.count(n.text) > 0, {left, right});
+      // Sums, differences and products of integers are integers, quotients and powers are not.
+      bool keeps_int = n.text == "+" || n.text == "-" || n.text == "*";
+      if (keeps_int && left.may_be_int && right.may_be_int) {
+        vector<uint32_t> int_variables;
+        set_union(left.int_variables.begin(), left.int_variables.end(),
+                  right.int_variables.begin(), right.int_variables.end(),
+                  back_inserter(int_variables));
+        *operand = Integer(*operand, std::move(int_variables));
+      }
+      return true;
+    }
+    it = kLogical.find(n.text);
+    if (it == kLogical.end() || !left.is_bool || !right.is_bool) return false;
+    *operand = Emit(it->second, true, {left, right});
+    return true;
+  }
+
+  bool LowerCall(const ExprNode &n, Operand *operand) {
+    vector<Operand> arguments(n.children.size());
+    for (size_t i = 0; i < n.children.size(); i++) {
+      if (!Lower(n.children[i], &arguments[i]) || arguments[i].is_bool) return false;
+    }
+
+    if (n.text == "pow" && arguments.size() == 2) {
+      *operand = Emit(NumericOp::kPower, false, {arguments[0], arguments[1]});
+      return true;
+    }
+    auto it = kRealFunctions.find(n.text);
+    if (it == kRealFunctions.end() || arguments.size() != 1) return false;
+    *operand = Emit(NumericOp::kCall, false, {arguments[0]}, it->second);
+    return true;
+  }
+
+  Operand Constant(double value, bool is_bool) {
+    program_->registers_.push_back(value);
+    return Operand{static_cast<uint32_t>(program_->registers_.size() - 1), is_bool, true};
+  }
+
+  /**
+   * Appends an instruction computing a new register from @inputs, or computes it right away when
+   * all of them are constants.
+   */
+  Operand Emit(NumericOp op, bool is_bool, initializer_list<Operand> inputs,
+               double (*function)(double) = nullptr) {
+    NumericInstruction instruction{op, 0, 0, 0, 0, function};
+    uint32_t *slots[] = {&instruction.a, &instruction.b, &instruction.c};
+    bool constant = true;
+    size_t i = 0;
+    for (const Operand &input : inputs) {
+      *slots[i++] = input.reg;
+      constant = constant && input.is_constant;
+    }
+
+    program_->registers_.push_back(0.0);
+    instruction.dst = static_cast<uint32_t>(program_->registers_.size() - 1);
+    if (constant) {
+      Execute(instruction, program_->registers_.data());
+    } else {
+      program_->code_.push_back(instruction);
+    }
+    return Operand{instruction.dst, is_bool, constant};
+  }
+
+  const ExprGraph &graph_;
+  const vector<string> &variable_names_;
+  unique_ptr<NumericProgram> program_;
+  unordered_map<int, Operand> lowered_;
+};
+
+unique_ptr<NumericProgram> NumericProgram::Compile(const string &formula,
+                                                   const vector<string> &variable_names) {
+  ExprGraph graph;
+  int root = ParseExpression(formula, graph);
+  if (root < 0) return nullptr;
+  return NumericCompiler(graph, variable_names).Compile(root);
+}
+
+double NumericProgram::Run() {
+  double *registers = registers_.data();
+  for (const NumericInstruction &instruction : code_) {
+    Execute(instruction, registers);
+  }
+  return registers[result_];
+}
+
+size_t NumericProgram::BlockRows(size_t register_count) {
+  size_t rows = kBlockBytes / (sizeof(double) * max<size_t>(register_count, 1));
+  rows = min(max(rows, kMinBlockRows), kMaxBlockRows);
+  return rows & ~size_t(3);
+}
+
+void NumericProgram::RunColumns(const double *const *columns, size_t rows, double *out,
+                                int simd_level) const {
+  SimdLevel level = simd_level < 0 ? DetectSimdLevel() : static_cast<SimdLevel>(simd_level);
+  size_t block_rows = BlockRows(registers_.size());
+
+  // Constants are broadcast once over their blocks. Variables are read in place from the columns,
+  // as instructions never write them.
+  EvalArenaScope scope;
+  ArenaVector<double> blocks(registers_.size() * block_rows);
+  ArenaVector<double*> registers(registers_.size());
+  for (size_t i = variable_count_; i < registers_.size(); i++) {
+    registers[i] = blocks.data() + i * block_rows;
+    fill(registers[i], registers[i] + block_rows, registers_[i]);
+  }
+
+  for (size_t start = 0; start < rows; start += block_rows) {
+    size_t count = min(block_rows, rows - start);
+    for (size_t i = 0; i < variable_count_; i++) {
+      registers[i] = const_cast<double*>(columns[i] + start);
+    }
+    for (const NumericInstruction &instruction : code_) {
+      ExecuteBlock(level, instruction, registers.data(), count);
+    }
+    memcpy(out + start, registers[result_], count * sizeof(double));
+  }
+}
+
+}  // namespace parsec_linux
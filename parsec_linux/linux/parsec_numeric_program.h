@@ -0,0 +1,144 @@
+#ifndef PARSEC_LINUX_PARSEC_NUMERIC_PROGRAM_H_
+#define PARSEC_LINUX_PARSEC_NUMERIC_PROGRAM_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace parsec_linux {
+
+enum class NumericOp : uint8_t {
+  kAdd,
+  kSubtract,
+  kMultiply,
+  kDivide,
+  kPower,
+  kNegate,
+  kEqual,
+  kNotEqual,
+  kLess,
+  kGreater,
+  kLessEqual,
+  kGreaterEqual,
+  kAnd,
+  kOr,
+  // dst = a != 0 ? b : c
+  kSelect,
+  // dst = function(a)
+  kCall,
+};
+
+/**
+ * @brief One instruction of a NumericProgram, reading and writing registers by index.
+ */
+struct NumericInstruction {
+  NumericOp op;
+  uint32_t dst;
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+  double (*function)(double);
+};
+
+/**
+ * @brief A formula lowered to register bytecode over plain doubles.
+ *
+ * muparserx evaluates every RPN token through its polymorphic values, which branch on the type and
+ * may hold strings, complex numbers or matrices. A formula that only uses numbers, the arithmetic
+ * and comparison operators, and, or, ternaries and real builtins does not need any of that: it is
+ * lowered to instructions over one contiguous array of doubles, booleans being 1 and 0.
+ *
+ * Registers hold the variables first, in the order given at compile time, then the constants and
+ * then one register per distinct subexpression, so repeated subexpressions are computed once.
+ * Subexpressions over constants are computed at compile time.
+ *
+ * Every instruction computes what muparserx computes for the same operator or builtin, with the
+ * same libm function, so results are identical. muparserx does not raise errors for the operations
+ * a program accepts: out of their domain, as in sqrt(-1), ln(0) or 1/0, they return NaN or
+ * infinities in both, which parsec_benchmark checks row by row. Both branches of a ternary are
+ * computed, which is harmless since they have no side effects.
+ */
+class NumericProgram {
+ public:
+  /**
+   * @brief Lowers @p formula, returning nullptr unless it provably evaluates to a number or a
+   * boolean when every name of @p variable_names holds a number.
+   */
+  static std::unique_ptr<NumericProgram> Compile(const std::string &formula,
+                                                 const std::vector<std::string> &variable_names);
+
+  /**
+   * @brief Register of the variable at @p index, to set before Run().
+   */
+  double &variable(size_t index) { return registers_[index]; }
+
+  /**
+   * @brief Whether the formula evaluates to a boolean, returned by Run() as 1 or 0.
+   */
+  bool returns_bool() const { return returns_bool_; }
+
+  /**
+   * @brief Whether muparserx types the result as an integer, rather than a float, when every
+   * variable of int_variables() holds an integer: the formula only combines integer literals and
+   * variables with +, - and * and the prefix minus, and ternaries of those.
+   */
+  bool may_return_int() const { return may_return_int_; }
+
+  /**
+   * @brief Indexes of the variables the result is an integer only if they are.
+   */
+  const std::vector<uint32_t> &int_variables() const { return int_variables_; }
+
+  /**
+   * @brief Whether may_return_int() and int_variables() give the muparserx type of the result.
+   * They do not when a ternary picks between an integer and a float: the program computes the
+   * value, but its type depends on the branch taken.
+   */
+  bool result_type_known() const { return result_type_known_; }
+
+  size_t instruction_count() const { return code_.size(); }
+
+  /**
+   * @brief Runs the program with the current variable registers and returns its result.
+   *
+   * Not thread-safe: runs share the registers.
+   */
+  double Run();
+
+  /**
+   * @brief Runs the program once per row of @p columns, one array of @p rows doubles per variable,
+   * writing the results to @p out.
+   *
+   * Rows are processed in blocks small enough for the registers of a block to stay in L1, running
+   * each instruction over the whole block with the vector instructions of @p simd_level, or of the
+   * CPU when it is negative. Results are bit-for-bit those of Run().
+   *
+   * Unlike Run(), reentrant: calls from several threads may run at once.
+   */
+  void RunColumns(const double *const *columns, size_t rows, double *out,
+                  int simd_level = -1) const;
+
+  /**
+   * @brief Rows per block of RunColumns() for a program of @p register_count registers.
+   */
+  static size_t BlockRows(size_t register_count);
+
+ private:
+  NumericProgram() = default;
+
+  std::vector<NumericInstruction> code_;
+  std::vector<double> registers_;
+  size_t variable_count_ = 0;
+  uint32_t result_ = 0;
+  bool returns_bool_ = false;
+  bool may_return_int_ = false;
+  std::vector<uint32_t> int_variables_;
+  bool result_type_known_ = true;
+
+  friend class NumericCompiler;
+};
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_NUMERIC_PROGRAM_H_
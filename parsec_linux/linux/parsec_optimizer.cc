@@ -0,0 +1,384 @@
+#include "parsec_optimizer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "mpParser.h"
+#include "parsec_expression.h"
+#include "parsec_parser_pool.h"
+
+using namespace std;
+
+namespace parsec_linux {
+
+namespace {
+
+// Builtins returning a number, or failing.
+const unordered_set<string> kNumericFunctions = {
+    "sin", "cos", "tan", "asin", "acos", "atan", "sinh", "cosh", "tanh", "asinh", "acosh",
+    "atanh", "sqrt", "cbrt", "exp", "ln", "log", "log2", "log10", "abs", "sign", "rint", "round",
+    "round_decimal", "pow", "min", "max", "sum", "avg"};
+
+// Builtins whose result only depends on their arguments, besides the numeric ones.
+const unordered_set<string> kPureFunctions = {
+    "length", "toupper", "tolower", "concat", "left", "right", "str2number", "number", "string",
+    "link", "default_value"};
+
+// Cost of a function call relative to an operator.
+constexpr size_t kCallCost = 8;
+// Minimum cost saved by hoisting a repeated subexpression: a hoisted subexpression is evaluated
+// by its own muparserx parser, whose fixed overhead is about the cost of two function calls.
+constexpr size_t kHoistMinSaving = 2 * kCallCost;
+
+bool IsPureFunction(const string &name) {
+  return kNumericFunctions.count(name) > 0 || kPureFunctions.count(name) > 0;
+}
+
+bool ParseNumber(const string &text, double *value) {
+  const char *begin = text.c_str();
+  char *end = nullptr;
+  *value = strtod(begin, &end);
+  return end != begin && *end == '\0';
+}
+
+class Optimizer {
+ public:
+  Optimizer(const ExprGraph &source, const vector<string> &variable_names)
+      : source_(source), variables_(variable_names.begin(), variable_names.end()) {}
+
+  OptimizedFormula Run(int source_root) {
+    OptimizedFormula result;
+    result.stats.nodes_before = source_.TreeSize(source_root);
+
+    int root = Optimize(source_root);
+    result.stats.folded = folded_;
+    result.stats.identities = identities_;
+    result.stats.shared = graph_.TreeSize(root) - graph_.DagSize(root);
+
+    Hoist(root);
+    result.stats.hoisted = hoisted_.size();
+
+    // Inner subexpressions have fewer nodes than the ones containing them, so evaluating them by
+    // increasing size evaluates every subexpression before its users.
+    vector<int> order(hoisted_.begin(), hoisted_.end());
+    sort(order.begin(), order.end(), [this](int a, int b) {
+      return graph_.TreeSize(a) < graph_.TreeSize(b);
+    });
+
+    unordered_map<int, string> names;
+    size_t nodes_after = 0;
+    for (int id : order) {
+      string name = SubexpressionName(names.size());
+      result.subexpressions.emplace_back(name, graph_.Render(id, &names));
+      nodes_after += TreeSize(id, names);
+      names.emplace(id, name);
+    }
+    result.formula = graph_.Render(root, &names);
+    nodes_after += TreeSize(root, names);
+    result.stats.nodes_after = nodes_after;
+
+    result.optimized = folded_ > 0 || identities_ > 0 || !hoisted_.empty();
+    return result;
+  }
+
+ private:
+  struct Visits {
+    size_t count = 0;
+    bool unconditional = false;
+  };
+
+  int Optimize(int source_id) {
+    auto it = optimized_.find(source_id);
+    if (it != optimized_.end()) return it->second;
+
+    const ExprNode &source_node = source_.node(source_id);
+    vector<int> children;
+    for (int child : source_node.children) {
+      children.push_back(Optimize(child));
+    }
+    int id = Simplify(graph_.Add(source_node.kind, source_node.text, std::move(children)));
+    optimized_.emplace(source_id, id);
+    return id;
+  }
+
+  int Simplify(int id) {
+    const ExprNode &n = graph_.node(id);
+
+    if (n.kind == ExprKind::kTernary) {
+      const ExprNode &condition = graph_.node(n.children[0]);
+      if (condition.kind == ExprKind::kBoolean) {
+        folded_++;
+        return condition.text == "true" ? n.children[1] : n.children[2];
+      }
+    }
+
+    int reduced = ApplyIdentity(id);
+    if (reduced != id) {
+      identities_++;
+      return reduced;
+    }
+
+    if (IsFoldable(id)) return Fold(id);
+    return id;
+  }
+
+  int ApplyIdentity(int id) const {
+    const ExprNode &n = graph_.node(id);
+    if (n.kind == ExprKind::kUnary) {
+      const ExprNode &operand = graph_.node(n.children[0]);
+      if (operand.kind == ExprKind::kUnary && IsNumeric(operand.children[0])) {
+        return operand.children[0];
+      }
+      return id;
+    }
+    if (n.kind != ExprKind::kBinary) return id;
+
+    // Only identities keeping the type muparserx gives the result: an integer times or minus an
+    // integer literal is an integer, and a float a float, but x / 1 and x ^ 1 are always floats,
+    // and so is x * 1.0.
+    int left = n.children[0];
+    int right = n.children[1];
+    if (n.text == "*" && IsIntegerLiteral(left, 1) && IsNumeric(right)) return right;
+    if (n.text == "*" && IsIntegerLiteral(right, 1) && IsNumeric(left)) return left;
+    // x + 0 is not x for x = -0, but x - 0 always is.
+    if (n.text == "-" && IsIntegerLiteral(right, 0) && IsNumeric(left)) return left;
+    return id;
+  }
+
+  /**
+   * Whether the node is a literal without a fraction or an exponent, which muparserx types as an
+   * integer, of value @p expected.
+   */
+  bool IsIntegerLiteral(int id, double expected) const {
+    const ExprNode &n = graph_.node(id);
+    double value;
+    return n.kind == ExprKind::kNumber && n.text.find_first_not_of("0123456789") == string::npos &&
+           ParseNumber(n.text, &value) && value == expected;
+  }
+
+  /**
+   * Whether the subexpression evaluates to a number, an integer or a float, or fails, whatever the
+   * type of the variables.
+   */
+  bool IsNumeric(int id) const {
+    const ExprNode &n = graph_.node(id);
+    switch (n.kind) {
+      case ExprKind::kNumber:
+      case ExprKind::kUnary:
+      case ExprKind::kPostfix:
+        return true;
+      case ExprKind::kBinary:
+        if (n.text == "+") return IsNumeric(n.children[0]) && IsNumeric(n.children[1]);
+        return n.text == "-" || n.text == "*" || n.text == "/" || n.text == "^";
+      case ExprKind::kCall:
+        return kNumericFunctions.count(n.text) > 0;
+      default:
+        return false;
+    }
+  }
+
+  bool IsConstant(int id) const {
+    const ExprNode &n = graph_.node(id);
+    switch (n.kind) {
+      case ExprKind::kNumber:
+      case ExprKind::kString:
+      case ExprKind::kBoolean:
+        return true;
+      case ExprKind::kName:
+        return (n.text == "pi" || n.text == "e") && variables_.count(n.text) == 0;
+      default:
+        return false;
+    }
+  }
+
+  bool IsFoldable(int id) const {
+    const ExprNode &n = graph_.node(id);
+    switch (n.kind) {
+      case ExprKind::kUnary:
+      case ExprKind::kBinary:
+      case ExprKind::kPostfix:
+      case ExprKind::kTernary:
+        break;
+      case ExprKind::kCall:
+        if (!IsPureFunction(n.text) || n.children.empty()) return false;
+        break;
+      default:
+        return false;
+    }
+    return all_of(n.children.begin(), n.children.end(), [this](int child) {
+      return IsConstant(child);
+    });
+  }
+
+  /**
+   * Evaluates the constant subexpression @id with muparserx and returns the literal of its value,
+   * or @id itself when it fails or its value has no literal.
+   */
+  int Fold(int id) {
+    if (scratch_ == nullptr) scratch_ = GlobalParserPool().Acquire();
+
+    try {
+      scratch_->SetExpr(graph_.Render(id));
+      const mup::IValue &value = scratch_->Eval();
+
+      string text;
+      ExprKind kind = ExprKind::kNumber;
+      switch (value.GetType()) {
+        case 'i':
+          text = to_string(value.GetInteger());
+          break;
+        case 'f':
+          if (!FloatLiteral(value.GetFloat(), &text)) return id;
+          break;
+        case 'b':
+          kind = ExprKind::kBoolean;
+          text = value.GetBool() ? "true" : "false";
+          break;
+        case 's': {
+          const string &s = value.GetString();
+          if (s.find_first_of("\"\\") != string::npos) return id;
+          kind = ExprKind::kString;
+          text = "\"" + s + "\"";
+          break;
+        }
+        default:
+          return id;
+      }
+      if (text[0] == '-') text = "(" + text + ")";
+
+      folded_++;
+      return graph_.Add(kind, text);
+    } catch (mup::ParserError &) {
+      return id;
+    }
+  }
+
+  /**
+   * Writes @value as the shortest literal muparserx reads back as the same float, with a decimal
+   * point so it is not mistaken for an integer. Infinities and NaN have no literal.
+   */
+  static bool FloatLiteral(double value, string *text) {
+    if (!isfinite(value)) return false;
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    text->assign(buffer, result.ptr);
+    if (text->find_first_of(".e") == string::npos) *text += ".0";
+    return true;
+  }
+
+  /**
+   * Chooses the repeated subexpressions to hoist, the biggest first, counting the uses of a
+   * hoisted subexpression once again after each choice.
+   */
+  void Hoist(int root) {
+    while (true) {
+      unordered_map<int, Visits> visits;
+      Visit(root, false, visits);
+      for (int id : hoisted_) {
+        for (int child : graph_.node(id).children) {
+          Visit(child, false, visits);
+        }
+      }
+
+      int best = -1;
+      size_t best_size = 0;
+      for (const auto &entry : visits) {
+        int id = entry.first;
+        if (entry.second.count < 2 || !entry.second.unconditional || hoisted_.count(id) > 0) {
+          continue;
+        }
+        if ((entry.second.count - 1) * Cost(id) < kHoistMinSaving || !IsPure(id)) continue;
+        size_t size = graph_.TreeSize(id);
+        if (size > best_size || (size == best_size && id < best)) {
+          best = id;
+          best_size = size;
+        }
+      }
+      if (best < 0 || variables_.count(SubexpressionName(hoisted_.size())) > 0) return;
+      hoisted_.insert(best);
+    }
+  }
+
+  /**
+   * Counts how many times each node is evaluated, and whether it is evaluated at least once
+   * outside of a ternary branch, where hoisting it could not raise an error the formula skips.
+   */
+  void Visit(int id, bool conditional, unordered_map<int, Visits> &visits) const {
+    Visits &node_visits = visits[id];
+    node_visits.count++;
+    if (!conditional) node_visits.unconditional = true;
+    if (hoisted_.count(id) > 0) return;
+
+    const ExprNode &n = graph_.node(id);
+    for (size_t i = 0; i < n.children.size(); i++) {
+      bool branch = n.kind == ExprKind::kTernary && i > 0;
+      Visit(n.children[i], conditional || branch, visits);
+    }
+  }
+
+  size_t Cost(int id) const {
+    const ExprNode &n = graph_.node(id);
+    if (n.children.empty()) return 0;
+    size_t cost = n.kind == ExprKind::kCall ? kCallCost : 1;
+    for (int child : n.children) {
+      cost += Cost(child);
+    }
+    return cost;
+  }
+
+  bool IsPure(int id) const {
+    const ExprNode &n = graph_.node(id);
+    if (n.kind == ExprKind::kCall && !IsPureFunction(n.text)) return false;
+    return all_of(n.children.begin(), n.children.end(), [this](int child) {
+      return IsPure(child);
+    });
+  }
+
+  size_t TreeSize(int id, const unordered_map<int, string> &names) const {
+    size_t size = 1;
+    for (int child : graph_.node(id).children) {
+      size += names.count(child) > 0 ? 1 : TreeSize(child, names);
+    }
+    return size;
+  }
+
+  static string SubexpressionName(size_t index) {
+    return "parsec_cse_" + to_string(index);
+  }
+
+  const ExprGraph &source_;
+  unordered_set<string> variables_;
+  ExprGraph graph_;
+  unordered_map<int, int> optimized_;
+  unordered_set<int> hoisted_;
+  PooledParser scratch_;
+  size_t folded_ = 0;
+  size_t identities_ = 0;
+};
+
+}  // namespace
+
+OptimizedFormula OptimizeFormula(const string &formula, const vector<string> &variable_names) {
+  ExprGraph source;
+  int root = ParseExpression(formula, source);
+  if (root < 0) {
+    OptimizedFormula result;
+    result.formula = formula;
+    return result;
+  }
+
+  OptimizedFormula result = Optimizer(source, variable_names).Run(root);
+  if (!result.optimized) {
+    result.formula = formula;
+    result.subexpressions.clear();
+    result.stats.nodes_after = result.stats.nodes_before;
+  }
+  return result;
+}
+
+}  // namespace parsec_linux
@@ -0,0 +1,62 @@
+#ifndef PARSEC_LINUX_PARSEC_OPTIMIZER_H_
+#define PARSEC_LINUX_PARSEC_OPTIMIZER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace parsec_linux {
+
+/**
+ * @brief What the optimizer did to a formula.
+ */
+struct OptimizerStats {
+  // RPN nodes of the formula as written.
+  size_t nodes_before = 0;
+  // RPN nodes evaluated once optimized, over the formula and its hoisted subexpressions.
+  size_t nodes_after = 0;
+  // Constant subexpressions replaced by their value, and ternaries with a constant condition.
+  size_t folded = 0;
+  // Algebraic identities applied, like x * 1 to x.
+  size_t identities = 0;
+  // Repeated subexpressions evaluated once ahead of the formula.
+  size_t hoisted = 0;
+  // Nodes of repeated subexpressions merged in the expression graph.
+  size_t shared = 0;
+
+  size_t nodes_removed() const { return nodes_before > nodes_after ? nodes_before - nodes_after : 0; }
+};
+
+struct OptimizedFormula {
+  // False when the formula is left as written, because it could not be improved or uses syntax
+  // the optimizer does not handle.
+  bool optimized = false;
+  // Text of the optimized formula, referencing the hoisted subexpressions by name.
+  std::string formula;
+  // Name and text of each hoisted subexpression, in evaluation order: a subexpression only
+  // references the ones before it.
+  std::vector<std::pair<std::string, std::string>> subexpressions;
+  OptimizerStats stats;
+};
+
+/**
+ * @brief Rewrites @p formula into an equivalent formula that is cheaper to evaluate repeatedly.
+ *
+ * - Pure builtin calls and operators on constants are evaluated once by muparserx and replaced
+ *   by their value, so folding can never disagree with evaluation. Calls that fail are kept, to
+ *   fail at evaluation as before, and so are impure ones like current_date().
+ * - Ternaries with a constant condition are replaced by the taken branch.
+ * - x * 1, 1 * x, x - 0 and -(-x) are reduced to x when x is known to be a number, 1 and 0 being
+ *   integer literals, so the result keeps the integer or float type muparserx gives it.
+ * - Identical subexpressions share one node. Those evaluated unconditionally and often enough to
+ *   save more than the overhead of a separate evaluation are hoisted into named subexpressions,
+ *   evaluated once per evaluation.
+ *
+ * @p variable_names are the variables of the formula, which are never treated as constants.
+ */
+OptimizedFormula OptimizeFormula(const std::string &formula,
+                                 const std::vector<std::string> &variable_names);
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_OPTIMIZER_H_
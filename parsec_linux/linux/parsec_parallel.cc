@@ -0,0 +1,194 @@
+#include "parsec_parallel.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "parsec_eval_arena.h"
+
+using namespace std;
+
+namespace parsec_linux {
+
+namespace {
+
+// Rows per chunk of EvaluateColumnsParallel(), enough to amortize taking a chunk. A multiple of 8
+// so chunks never share a byte of the error bitmap.
+constexpr size_t kColumnChunkRows = 4096;
+
+}  // namespace
+
+ParallelExecutor::ParallelExecutor(size_t threads) {
+  requested_threads_.store(max<size_t>(threads, 1), memory_order_relaxed);
+  StartWorkers(threads);
+}
+
+ParallelExecutor::~ParallelExecutor() {
+  lock_guard<mutex> job(job_mutex_);
+  StopWorkers();
+}
+
+size_t ParallelExecutor::threads() const {
+  return requested_threads_.load(memory_order_relaxed);
+}
+
+void ParallelExecutor::SetThreads(size_t threads) {
+  requested_threads_.store(max<size_t>(threads, 1), memory_order_relaxed);
+}
+
+void ParallelExecutor::ApplyThreads() {
+  size_t requested = requested_threads_.load(memory_order_relaxed);
+  if (requested == threads_.load(memory_order_relaxed)) return;
+  // The workers are idle between For() calls, so joining them does not wait for any work.
+  StopWorkers();
+  StartWorkers(requested);
+}
+
+void ParallelExecutor::StartWorkers(size_t threads) {
+  threads = max<size_t>(threads, 1);
+  runs_.reset(new Run[threads]);
+  threads_.store(threads, memory_order_relaxed);
+  for (size_t participant = 1; participant < threads; participant++) {
+    workers_.emplace_back(&ParallelExecutor::WorkerLoop, this, participant, generation_);
+  }
+}
+
+void ParallelExecutor::StopWorkers() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (thread &worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  stopping_ = false;
+}
+
+void ParallelExecutor::For(size_t count, size_t grain, const Body &body) {
+  if (count == 0) return;
+  grain = max<size_t>(grain, 1);
+  size_t chunks = (count + grain - 1) / grain;
+
+  unique_lock<mutex> job(job_mutex_, try_to_lock);
+  if (job.owns_lock()) ApplyThreads();
+  size_t threads = threads_.load(memory_order_relaxed);
+  if (!job.owns_lock() || threads == 1 || chunks == 1) {
+    body(0, count, 0);
+    return;
+  }
+
+  // Participant p runs chunks [p * chunks / threads, (p + 1) * chunks / threads) unless stolen.
+  for (size_t participant = 0; participant < threads; participant++) {
+    Run &run = runs_[participant];
+    for (size_t chunk = participant * chunks / threads; chunk < (participant + 1) * chunks / threads;
+         chunk++) {
+      run.chunks.emplace_back(chunk * grain, min(count, (chunk + 1) * grain));
+    }
+  }
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    body_ = &body;
+    pending_workers_ = threads - 1;
+    error_ = nullptr;
+    generation_++;
+  }
+  wake_.notify_all();
+
+  Participate(0, body);
+
+  exception_ptr error;
+  {
+    unique_lock<mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_workers_ == 0; });
+    body_ = nullptr;
+    error = error_;
+  }
+  if (error != nullptr) rethrow_exception(error);
+}
+
+void ParallelExecutor::WorkerLoop(size_t participant, uint64_t generation) {
+  while (true) {
+    const Body *body;
+    {
+      unique_lock<mutex> lock(mutex_);
+      wake_.wait(lock, [this, generation] { return stopping_ || generation_ != generation; });
+      if (stopping_) return;
+      generation = generation_;
+      body = body_;
+    }
+
+    Participate(participant, *body);
+
+    lock_guard<mutex> lock(mutex_);
+    if (--pending_workers_ == 0) done_.notify_one();
+  }
+}
+
+void ParallelExecutor::Participate(size_t participant, const Body &body) {
+  pair<size_t, size_t> chunk;
+  while (Take(participant, &chunk)) {
+    try {
+      body(chunk.first, chunk.second, participant);
+    } catch (...) {
+      lock_guard<mutex> lock(mutex_);
+      if (error_ == nullptr) error_ = current_exception();
+    }
+  }
+}
+
+bool ParallelExecutor::Take(size_t participant, pair<size_t, size_t> *chunk) {
+  size_t threads = threads_.load(memory_order_relaxed);
+  for (size_t i = 0; i < threads; i++) {
+    // Own run first, from the front, then the others from the back.
+    Run &run = runs_[(participant + i) % threads];
+    lock_guard<mutex> lock(run.mutex);
+    if (run.chunks.empty()) continue;
+    if (i == 0) {
+      *chunk = run.chunks.front();
+      run.chunks.pop_front();
+    } else {
+      *chunk = run.chunks.back();
+      run.chunks.pop_back();
+    }
+    return true;
+  }
+  return false;
+}
+
+size_t EvaluateColumnsParallel(ParallelExecutor &executor, CompiledFormula &formula,
+                               const double *const *columns, size_t rows, double *out,
+                               uint8_t *error_bitmap) {
+  size_t variable_count = formula.variable_names().size();
+
+  // Participant 0 evaluates with @formula, the others with their own copy unless it is shared.
+  mutex copies_mutex;
+  unordered_map<size_t, unique_ptr<CompiledFormula>> copies;
+  atomic<size_t> errors{0};
+  executor.For(rows, kColumnChunkRows, [&](size_t begin, size_t end, size_t participant) {
+    CompiledFormula *evaluated = &formula;
+    if (participant > 0 && !formula.numeric()) {
+      unique_lock<mutex> lock(copies_mutex);
+      unique_ptr<CompiledFormula> &copy = copies[participant];
+      lock.unlock();
+      // Only this participant ever touches its own entry.
+      if (copy == nullptr) {
+        copy = make_unique<CompiledFormula>(formula.formula(), formula.variable_names(), true);
+      }
+      evaluated = copy.get();
+    }
+
+    EvalArenaScope scope;
+    ArenaVector<const double*> slice(variable_count);
+    for (size_t i = 0; i < variable_count; i++) {
+      slice[i] = columns[i] + begin;
+    }
+    errors.fetch_add(evaluated->EvaluateColumns(slice.data(), end - begin, out + begin,
+                                                error_bitmap + begin / 8),
+                     memory_order_relaxed);
+  });
+  return errors.load(memory_order_relaxed);
+}
+
+}  // namespace parsec_linux
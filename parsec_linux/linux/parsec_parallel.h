@@ -0,0 +1,116 @@
+#ifndef PARSEC_LINUX_PARSEC_PARALLEL_H_
+#define PARSEC_LINUX_PARSEC_PARALLEL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "parsec_compiled_formula.h"
+
+namespace parsec_linux {
+
+/**
+ * @brief Work-stealing executor splitting an index range across a fixed set of threads.
+ *
+ * For() cuts the range into chunks and deals them out as contiguous runs, one per participant:
+ * the calling thread and threads() - 1 worker threads kept alive between calls. Each participant
+ * takes the chunks of its own run from the front and, once it is done, steals the chunks left at
+ * the back of the others, so a run of slow formulas does not leave the other cores idle.
+ *
+ * Participants only write the slots of the indices they are handed, so results land in input order
+ * whatever the scheduling.
+ */
+class ParallelExecutor {
+ public:
+  // Called with a chunk [begin, end) and the index of the participant running it, below threads().
+  using Body = std::function<void(size_t begin, size_t end, size_t participant)>;
+
+  explicit ParallelExecutor(size_t threads);
+  ~ParallelExecutor();
+
+  // Disallow copy and assign: the worker threads point to the executor.
+  ParallelExecutor(const ParallelExecutor&) = delete;
+  ParallelExecutor& operator=(const ParallelExecutor&) = delete;
+
+  /**
+   * @brief Number of threads running a For() call, the calling one included.
+   *
+   * Reports the last count passed to SetThreads(), even before the threads are started.
+   */
+  size_t threads() const;
+
+  /**
+   * @brief Changes the number of threads without waiting: the next For() call using the threads
+   * starts or stops workers to match, so a caller never blocks on the For() call in progress.
+   */
+  void SetThreads(size_t threads);
+
+  /**
+   * @brief Runs @p body over [0, @p count) in chunks of @p grain indices and returns once all of
+   * them ran.
+   *
+   * Runs on the calling thread alone when the range is a single chunk, or when another For() call
+   * is using the threads, so concurrent callers never wait for each other. The first exception
+   * thrown by @p body is rethrown once every chunk ran.
+   */
+  void For(size_t count, size_t grain, const Body &body);
+
+ private:
+  struct Run {
+    std::mutex mutex;
+    std::deque<std::pair<size_t, size_t>> chunks;
+  };
+
+  void StartWorkers(size_t threads);
+  void StopWorkers();
+  void ApplyThreads();
+  void WorkerLoop(size_t participant, uint64_t generation);
+  void Participate(size_t participant, const Body &body);
+  bool Take(size_t participant, std::pair<size_t, size_t> *chunk);
+
+  // Held by the For() call using the threads, which changes them, and by the destructor.
+  std::mutex job_mutex_;
+
+  std::vector<std::thread> workers_;
+  std::unique_ptr<Run[]> runs_;
+  // Threads the workers were started for, only changed while holding job_mutex_.
+  std::atomic<size_t> threads_{1};
+  // Threads requested by SetThreads(), applied by the next For() call.
+  std::atomic<size_t> requested_threads_{1};
+
+  // Guards the job state below, shared with the workers.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const Body *body_ = nullptr;
+  uint64_t generation_ = 0;
+  size_t pending_workers_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+};
+
+/**
+ * @brief Evaluates @p formula over numeric columns like CompiledFormula::EvaluateColumns(), with
+ * the rows split across the threads of @p executor.
+ *
+ * A formula running on the numeric engine is shared, its column evaluation being reentrant. Any
+ * other formula is compiled again for each extra participant, so no muparserx parser is ever used
+ * by two threads.
+ *
+ * @throws mup::ParserError if compiling a copy of the formula fails.
+ */
+size_t EvaluateColumnsParallel(ParallelExecutor &executor, CompiledFormula &formula,
+                               const double *const *columns, size_t rows, double *out,
+                               uint8_t *error_bitmap);
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_PARALLEL_H_
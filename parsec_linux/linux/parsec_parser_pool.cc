@@ -0,0 +1,53 @@
+#include "parsec_parser_pool.h"
+
+using namespace std;
+using namespace mup;
+
+namespace parsec_linux {
+
+void ParserReleaser::operator()(ParserX *parser) const {
+  pool->Release(parser);
+}
+
+PooledParser ParserPool::Acquire() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      ParserX *parser = idle_.back().release();
+      idle_.pop_back();
+      return PooledParser(parser, ParserReleaser{this});
+    }
+  }
+  return PooledParser(new ParserX(pckALL_NON_COMPLEX), ParserReleaser{this});
+}
+
+void ParserPool::Prewarm(size_t count) {
+  count = min(count, kMaxIdle);
+  while (idle() < count) {
+    auto parser = make_unique<ParserX>(pckALL_NON_COMPLEX);
+    lock_guard<mutex> lock(mutex_);
+    idle_.push_back(std::move(parser));
+  }
+}
+
+size_t ParserPool::idle() const {
+  lock_guard<mutex> lock(mutex_);
+  return idle_.size();
+}
+
+void ParserPool::Release(ParserX *parser) {
+  unique_ptr<ParserX> owned(parser);
+  // The variables point into storage of the previous user, which is about to go away.
+  owned->ClearVar();
+
+  lock_guard<mutex> lock(mutex_);
+  if (idle_.size() < kMaxIdle) idle_.push_back(std::move(owned));
+}
+
+ParserPool &GlobalParserPool() {
+  // Never destroyed, so parsers released during static destruction still find it.
+  static ParserPool *pool = new ParserPool();
+  return *pool;
+}
+
+}  // namespace parsec_linux
@@ -0,0 +1,80 @@
+#ifndef PARSEC_LINUX_PARSEC_PARSER_POOL_H_
+#define PARSEC_LINUX_PARSEC_PARSER_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "mpParser.h"
+
+namespace parsec_linux {
+
+class ParserPool;
+
+/**
+ * @brief Hands a parser back to the pool it was acquired from.
+ */
+struct ParserReleaser {
+  ParserPool *pool;
+
+  void operator()(mup::ParserX *parser) const;
+};
+
+/**
+ * @brief A parser acquired from a ParserPool, released to it when destroyed.
+ */
+using PooledParser = std::unique_ptr<mup::ParserX, ParserReleaser>;
+
+/**
+ * @brief Idle muparserx parsers with every non-complex package registered, recycled across
+ * formulas.
+ *
+ * Setting up a ParserX creates and registers a callback object for each builtin function and
+ * operator, which costs more than parsing most formulas. A released parser keeps its callbacks and
+ * only drops its variables and expression, so acquiring it again skips that setup. The parsers
+ * cannot share a single set of callbacks instead: muparserx counts their references without
+ * synchronization, so each one is owned by one parser, and each parser by one user at a time.
+ *
+ * All methods are thread-safe.
+ */
+class ParserPool {
+ public:
+  // Idle parsers kept at most; parsers released beyond that are freed.
+  static constexpr size_t kMaxIdle = 256;
+
+  ParserPool() = default;
+
+  // Disallow copy and assign: acquired parsers point back to their pool.
+  ParserPool(const ParserPool&) = delete;
+  ParserPool& operator=(const ParserPool&) = delete;
+
+  /**
+   * @brief Returns an idle parser, without variables or expression, or a new one if none is idle.
+   */
+  PooledParser Acquire();
+
+  /**
+   * @brief Sets up parsers until @p count are idle, so the first formulas do not pay for it.
+   */
+  void Prewarm(size_t count);
+
+  size_t idle() const;
+
+ private:
+  friend struct ParserReleaser;
+
+  void Release(mup::ParserX *parser);
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<mup::ParserX>> idle_;
+};
+
+/**
+ * @brief The pool shared by the plugin instances and the dart:ffi entry points.
+ */
+ParserPool &GlobalParserPool();
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_PARSER_POOL_H_
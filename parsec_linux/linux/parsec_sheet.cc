@@ -0,0 +1,267 @@
+#include "parsec_sheet.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace mup;
+
+namespace parsec_linux {
+
+namespace {
+
+bool SameValue(const IValue &a, const IValue &b) {
+  char type = a.GetType();
+  if (type != b.GetType()) return false;
+
+  switch (type) {
+    case 'i':
+    case 'f':
+      return a.GetFloat() == b.GetFloat();
+    case 'b':
+      return a.GetBool() == b.GetBool();
+    case 's':
+      return a.GetString() == b.GetString();
+    default:
+      return a.ToString() == b.ToString();
+  }
+}
+
+}  // namespace
+
+void FormulaSheet::SetValue(const string &name, const Value &value) {
+  size_t index = CellIndex(name);
+  Cell &cell = cells_[index];
+  bool input = cell.defined && cell.formula == nullptr && cell.formula_error.empty();
+  if (input && cell.error.empty() && SameValue(cell.value, value)) return;
+
+  ClearFormula(index);
+  cell.defined = true;
+  cell.value = value;
+  cell.error.clear();
+  MarkDirty(index);
+}
+
+void FormulaSheet::SetFormula(const string &name, const string &formula) {
+  size_t index = CellIndex(name);
+  ClearFormula(index);
+  cells_[index].defined = true;
+  MarkDirty(index);
+
+  vector<string> references;
+  try {
+    // Querying the variables of a parser defining none lists every name the formula uses.
+    PooledParser parser = GlobalParserPool().Acquire();
+    parser->SetExpr(formula);
+    for (const auto &variable : parser->GetExprVar()) {
+      references.push_back(variable.first);
+    }
+  } catch (ParserError &error) {
+    cells_[index].formula_error = error.GetMsg();
+    return;
+  }
+
+  vector<size_t> dependencies;
+  for (const string &reference : references) {
+    // May grow the cells, so no reference to a cell is held across it.
+    size_t dependency = CellIndex(reference);
+    if (dependency == index || Reaches(index, dependency)) {
+      cells_[index].formula_error = "Circular reference: " + reference;
+      return;
+    }
+    dependencies.push_back(dependency);
+  }
+
+  Cell &cell = cells_[index];
+  try {
+    cell.formula = make_unique<CompiledFormula>(formula, references, true);
+  } catch (ParserError &error) {
+    cell.formula_error = error.GetMsg();
+    return;
+  }
+  cell.dependencies = std::move(dependencies);
+  for (size_t dependency : cell.dependencies) {
+    cells_[dependency].dependents.push_back(index);
+  }
+}
+
+void FormulaSheet::Remove(const string &name) {
+  auto it = index_.find(name);
+  if (it == index_.end()) return;
+
+  // The cell stays as a name its dependents reference.
+  ClearFormula(it->second);
+  cells_[it->second].defined = false;
+  MarkDirty(it->second);
+}
+
+vector<FormulaSheet::Change> FormulaSheet::Recalculate() {
+  uint64_t generation = ++generation_;
+  last_evaluations_ = 0;
+
+  // Every cell below a dirty one may change; the others cannot.
+  vector<size_t> affected;
+  vector<size_t> stack;
+  for (size_t index : dirty_) {
+    if (cells_[index].reached == generation) continue;
+    cells_[index].reached = generation;
+    stack.push_back(index);
+  }
+  while (!stack.empty()) {
+    size_t index = stack.back();
+    stack.pop_back();
+    affected.push_back(index);
+    for (size_t dependent : cells_[index].dependents) {
+      if (cells_[dependent].reached == generation) continue;
+      cells_[dependent].reached = generation;
+      stack.push_back(dependent);
+    }
+  }
+
+  // Kahn's algorithm over the affected cells: a cell is ready once its affected references are.
+  vector<size_t> ready;
+  for (size_t index : affected) {
+    Cell &cell = cells_[index];
+    cell.pending = count_if(cell.dependencies.begin(), cell.dependencies.end(),
+                            [this, generation](size_t dependency) {
+                              return cells_[dependency].reached == generation;
+                            });
+    if (cell.pending == 0) ready.push_back(index);
+  }
+
+  vector<Change> changes;
+  for (size_t next = 0; next < ready.size(); next++) {
+    Cell &cell = cells_[ready[next]];
+
+    bool stale = cell.dirty ||
+                 any_of(cell.dependencies.begin(), cell.dependencies.end(),
+                        [this, generation](size_t dependency) {
+                          return cells_[dependency].changed == generation;
+                        });
+    if (stale) {
+      bool changed;
+      if (cell.defined && cell.formula == nullptr && cell.formula_error.empty()) {
+        // An input cell is only dirty when its value was changed.
+        changed = true;
+      } else {
+        Value previous = cell.value;
+        string previous_error = cell.error;
+        Evaluate(cell);
+        changed = cell.error != previous_error ||
+                  (cell.error.empty() && !SameValue(cell.value, previous));
+      }
+
+      if (changed) {
+        cell.changed = generation;
+        if (cell.defined) changes.push_back(Change{cell.name, cell.value, cell.error});
+      }
+    }
+    cell.dirty = false;
+
+    for (size_t dependent : cell.dependents) {
+      Cell &below = cells_[dependent];
+      if (below.reached == generation && --below.pending == 0) ready.push_back(dependent);
+    }
+  }
+
+  dirty_.clear();
+  return changes;
+}
+
+size_t FormulaSheet::CellIndex(const string &name) {
+  auto it = index_.find(name);
+  if (it != index_.end()) return it->second;
+
+  size_t index = cells_.size();
+  cells_.emplace_back();
+  cells_.back().name = name;
+  cells_.back().error = "Undefined variable: " + name;
+  index_.emplace(name, index);
+  return index;
+}
+
+void FormulaSheet::MarkDirty(size_t index) {
+  if (cells_[index].dirty) return;
+  cells_[index].dirty = true;
+  dirty_.push_back(index);
+}
+
+void FormulaSheet::ClearFormula(size_t index) {
+  Cell &cell = cells_[index];
+  for (size_t dependency : cell.dependencies) {
+    vector<size_t> &dependents = cells_[dependency].dependents;
+    dependents.erase(find(dependents.begin(), dependents.end(), index));
+  }
+  cell.dependencies.clear();
+  cell.formula.reset();
+  cell.formula_error.clear();
+}
+
+bool FormulaSheet::Reaches(size_t from, size_t to) {
+  uint64_t generation = ++generation_;
+  vector<size_t> stack{from};
+  cells_[from].reached = generation;
+  while (!stack.empty()) {
+    size_t index = stack.back();
+    stack.pop_back();
+    if (index == to) return true;
+    for (size_t dependent : cells_[index].dependents) {
+      if (cells_[dependent].reached == generation) continue;
+      cells_[dependent].reached = generation;
+      stack.push_back(dependent);
+    }
+  }
+  return false;
+}
+
+void FormulaSheet::Evaluate(Cell &cell) {
+  if (!cell.defined) {
+    cell.value = Value();
+    cell.error = "Undefined variable: " + cell.name;
+    return;
+  }
+  if (!cell.formula_error.empty()) {
+    cell.value = Value();
+    cell.error = cell.formula_error;
+    return;
+  }
+
+  for (size_t i = 0; i < cell.dependencies.size(); i++) {
+    const Cell &dependency = cells_[cell.dependencies[i]];
+    if (!dependency.error.empty()) {
+      // The error of the first reference in error carries over.
+      cell.value = Value();
+      cell.error = dependency.error;
+      return;
+    }
+    cell.formula->variable(i) = dependency.value;
+  }
+
+  last_evaluations_++;
+  try {
+    cell.value = Value(cell.formula->Evaluate());
+    cell.error.clear();
+  } catch (ParserError &error) {
+    cell.value = Value();
+    cell.error = error.GetMsg();
+  }
+}
+
+int64_t SheetRegistry::Add(shared_ptr<FormulaSheet> sheet) {
+  lock_guard<mutex> lock(mutex_);
+  int64_t id = next_id_++;
+  sheets_[id] = std::move(sheet);
+  return id;
+}
+
+shared_ptr<FormulaSheet> SheetRegistry::Find(int64_t id) const {
+  lock_guard<mutex> lock(mutex_);
+  auto it = sheets_.find(id);
+  return it == sheets_.end() ? nullptr : it->second;
+}
+
+bool SheetRegistry::Remove(int64_t id) {
+  lock_guard<mutex> lock(mutex_);
+  return sheets_.erase(id) > 0;
+}
+
+}  // namespace parsec_linux
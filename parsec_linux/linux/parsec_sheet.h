@@ -0,0 +1,143 @@
+#ifndef PARSEC_LINUX_PARSEC_SHEET_H_
+#define PARSEC_LINUX_PARSEC_SHEET_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mpParser.h"
+#include "parsec_compiled_formula.h"
+
+namespace parsec_linux {
+
+/**
+ * @brief A set of named cells, holding either a value or a formula over other cells, recalculated
+ * incrementally like a spreadsheet.
+ *
+ * The references of each formula are the variables muparserx finds in it; they are the edges of a
+ * dependency graph kept acyclic. Changing cells only marks them dirty. Recalculate() then walks
+ * down from the dirty cells alone, evaluates the cells below them in topological order, skipping
+ * those none of whose references changed, and returns the cells whose value or error changed. Its
+ * cost follows the size of the change, not the size of the sheet.
+ *
+ * Cells referencing an undefined name, a cell in error or one of their own dependents hold an error
+ * instead of a value. Not thread-safe: hold mutex() while using the sheet.
+ */
+class FormulaSheet {
+ public:
+  /**
+   * @brief A cell whose value or error changed in a recalculation.
+   */
+  struct Change {
+    std::string name;
+    mup::Value value;
+    // Empty unless the cell is in error, in which case value is meaningless.
+    std::string error;
+  };
+
+  FormulaSheet() = default;
+
+  // Disallow copy and assign: the compiled formulas are owned by the cells.
+  FormulaSheet(const FormulaSheet&) = delete;
+  FormulaSheet& operator=(const FormulaSheet&) = delete;
+
+  std::mutex &mutex() { return mutex_; }
+
+  /**
+   * @brief Makes @p name an input cell holding @p value, replacing its formula if it had one.
+   */
+  void SetValue(const std::string &name, const mup::Value &value);
+
+  /**
+   * @brief Makes @p name a formula cell evaluating @p formula.
+   *
+   * An invalid formula, or one referencing @p name itself or one of its dependents, puts the cell
+   * in error until its formula is set again; the sheet stays acyclic.
+   */
+  void SetFormula(const std::string &name, const std::string &formula);
+
+  /**
+   * @brief Removes the cell @p name. Cells referencing it are put in error.
+   */
+  void Remove(const std::string &name);
+
+  /**
+   * @brief Evaluates the cells affected by the changes since the last call and returns the ones
+   * whose value or error changed, in evaluation order.
+   */
+  std::vector<Change> Recalculate();
+
+  /**
+   * @brief Number of formulas evaluated by the last Recalculate() call.
+   */
+  size_t last_evaluations() const { return last_evaluations_; }
+
+ private:
+  struct Cell {
+    std::string name;
+    // Whether the cell was set and not removed since; names only referenced are not defined.
+    bool defined = false;
+    // Formula of the cell, or nullptr for an input cell or a formula in error.
+    std::unique_ptr<CompiledFormula> formula;
+    // Error of a formula that cannot be evaluated at all: invalid, or referencing a dependent.
+    std::string formula_error;
+    // Cells the formula references, in the order of its variables.
+    std::vector<size_t> dependencies;
+    // Cells whose formula references this one.
+    std::vector<size_t> dependents;
+    mup::Value value;
+    std::string error;
+    // Set until the next recalculation when the cell itself was changed.
+    bool dirty = false;
+    // Recalculation generation the cell was last reached in, and last changed in.
+    uint64_t reached = 0;
+    uint64_t changed = 0;
+    // References not evaluated yet in the current recalculation.
+    size_t pending = 0;
+  };
+
+  size_t CellIndex(const std::string &name);
+  void MarkDirty(size_t index);
+  void ClearFormula(size_t index);
+  bool Reaches(size_t from, size_t to);
+  void Evaluate(Cell &cell);
+
+  std::mutex mutex_;
+  std::vector<Cell> cells_;
+  std::unordered_map<std::string, size_t> index_;
+  std::vector<size_t> dirty_;
+  uint64_t generation_ = 0;
+  size_t last_evaluations_ = 0;
+};
+
+/**
+ * @brief Owns the sheets of a plugin instance and hands out integer ids for them.
+ *
+ * All methods are thread-safe.
+ */
+class SheetRegistry {
+ public:
+  int64_t Add(std::shared_ptr<FormulaSheet> sheet);
+
+  /**
+   * @brief Returns the sheet registered under @p id, or nullptr if there is none.
+   */
+  std::shared_ptr<FormulaSheet> Find(int64_t id) const;
+
+  /**
+   * @brief Frees the sheet registered under @p id. Returns false if there was none.
+   */
+  bool Remove(int64_t id);
+
+ private:
+  mutable std::mutex mutex_;
+  std::unordered_map<int64_t, std::shared_ptr<FormulaSheet>> sheets_;
+  int64_t next_id_ = 1;
+};
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_SHEET_H_
@@ -0,0 +1,55 @@
+#include "parsec_value_json.h"
+
+#include <cstdio>
+
+#include "equationsParser.h"
+#include "parsec_eval_stats.h"
+
+using namespace std;
+
+namespace parsec_linux {
+
+/**
+ * Appends @p text to @p out as the contents of a JSON string, escaping it as needed.
+ */
+static void AppendEscaped(string &out, const string &text) {
+  for (char c : text) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if ((unsigned char) c < 0x20) {
+          char escaped[7];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char) c);
+          out += escaped;
+        } else {
+          out += c;
+        }
+    }
+  }
+}
+
+string EvalJson(string_view formula) {
+  string json;
+  EvalJson(formula, json);
+  return json;
+}
+
+void EvalJson(string_view formula, string &out) {
+  EvalStats &stats = GlobalEvalStats();
+  stats.RecordCall(formula.size());
+  out = EquationsParser::CalcJson(string(formula));
+  stats.RecordBytesOut(out.size());
+}
+
+string ErrorToJson(const string &message) {
+  string json = "{\"val\": null, \"type\": null, \"error\": \"";
+  AppendEscaped(json, message);
+  json += "\"}";
+  return json;
+}
+
+}  // namespace parsec_linux
@@ -0,0 +1,33 @@
+#ifndef PARSEC_LINUX_PARSEC_VALUE_JSON_H_
+#define PARSEC_LINUX_PARSEC_VALUE_JSON_H_
+
+#include <string>
+#include <string_view>
+
+namespace parsec_linux {
+
+/**
+ * @brief Evaluates @p formula with EquationsParser::CalcJson and returns its JSON result.
+ *
+ * The JSON results of the plugin all come from CalcJson, so their text stays the one of
+ * equations-parser; only the typed and binary results go through a formula cache. Counts the call
+ * and its bytes in GlobalEvalStats(), but not its phases nor its errors, which CalcJson does not
+ * report apart.
+ */
+std::string EvalJson(std::string_view formula);
+
+/**
+ * @brief Writes the EvalJson() result of @p formula to @p out, replacing its contents.
+ */
+void EvalJson(std::string_view formula, std::string &out);
+
+/**
+ * @brief Serializes an error raised by the plugin itself rather than by CalcJson, such as an
+ * equation that is not a string, in the CalcJson format
+ * `{"val": null, "type": null, "error": "<message>"}`.
+ */
+std::string ErrorToJson(const std::string &message);
+
+}  // namespace parsec_linux
+
+#endif  // PARSEC_LINUX_PARSEC_VALUE_JSON_H_
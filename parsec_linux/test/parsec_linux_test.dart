@@ -1,16 +1,132 @@
+import 'dart:typed_data';
+
 import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:parsec_linux/parsec_linux.dart';
+import 'package:parsec_platform_interface/parsec_eval_exception.dart';
 import 'package:parsec_platform_interface/parsec_platform_interface.dart';
 
 void main() {
   TestWidgetsFlutterBinding.ensureInitialized();
 
   const MethodChannel channel = MethodChannel('parsec_linux');
+  const EventChannel streamChannel = EventChannel('parsec_linux/eval_stream');
+  const EventChannel fileChannel = EventChannel('parsec_linux/eval_file');
+
+  MockStreamHandlerEventSink? streamEvents;
+  MockStreamHandlerEventSink? fileEvents;
+  var streamInFlight = 0;
+  var streamMaxInFlight = 0;
 
   setUp(() {
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockStreamHandler(
+        streamChannel,
+        MockStreamHandler.inline(onListen: (arguments, events) => streamEvents = events));
+    TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger.setMockStreamHandler(
+        fileChannel, MockStreamHandler.inline(onListen: (arguments, events) => fileEvents = events));
+
     TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
         .setMockMethodCallHandler(channel, (MethodCall methodCall) async {
+      if (methodCall.method == 'nativeEval') {
+        expect(methodCall.arguments['typed'], isTrue);
+        if (methodCall.arguments['equation'] == '2 + )') {
+          return {'val': null, 'error': 'Unexpected parenthesis'};
+        }
+        return {'val': 0.5, 'error': null};
+      }
+      if (methodCall.method == 'nativeEvalBatch') {
+        expect(methodCall.arguments['typed'], isTrue);
+        final equations = methodCall.arguments['equations'] as List;
+        return equations.map((equation) {
+          if (equation == '2 + )') {
+            return {'val': null, 'error': 'Unexpected parenthesis'};
+          }
+          return {'val': 5, 'error': null};
+        }).toList();
+      }
+      if (methodCall.method == 'openEvalStream') {
+        return 1;
+      }
+      if (methodCall.method == 'pushEvalStream') {
+        final equations = methodCall.arguments['equations'] as List;
+        streamInFlight += equations.length;
+        streamMaxInFlight = streamInFlight > streamMaxInFlight ? streamInFlight : streamMaxInFlight;
+        Future(() {
+          streamInFlight -= equations.length;
+          streamEvents!.success({
+            'id': methodCall.arguments['id'],
+            'results': equations.map((equation) {
+              if (equation == '2 + )') {
+                return {'val': null, 'error': 'Unexpected parenthesis'};
+              }
+              return {'val': 5, 'error': null};
+            }).toList(),
+          });
+        });
+        return null;
+      }
+      if (methodCall.method == 'evalFile') {
+        if (methodCall.arguments['inputPath'] == '/missing.txt') {
+          throw PlatformException(code: 'file_error', message: 'Cannot open /missing.txt');
+        }
+        expect(methodCall.arguments['format'], equals('binary'));
+        fileEvents?.success({
+          'job': methodCall.arguments['job'],
+          'lines': 65536,
+          'errors': 1,
+          'bytesRead': 500,
+          'bytesTotal': 1000,
+        });
+        return {'lines': 100000, 'errors': 2, 'bytesRead': 1000, 'bytesTotal': 1000};
+      }
+      if (methodCall.method == 'createSheet') {
+        return 1;
+      }
+      if (methodCall.method == 'updateSheet') {
+        expect(methodCall.arguments['values'], equals({'qty': 4}));
+        expect(methodCall.arguments.containsKey('remove'), isFalse);
+        return {
+          'qty': {'val': 4, 'error': null},
+          'total': {'val': 10.0, 'error': null},
+          'loop': {'val': null, 'error': 'Circular reference: loop'},
+        };
+      }
+      if (methodCall.method == 'nativeEvalColumns') {
+        final x = methodCall.arguments['columns']['x'] as Float64List;
+        return {
+          'values': Float64List.fromList(x.map((value) => value * 2).toList()),
+          'errors': Uint8List.fromList([0x02]),
+        };
+      }
+      if (methodCall.method == 'nativeCompile') {
+        if (methodCall.arguments['formula'] == '2 + )') {
+          throw PlatformException(code: 'compile_error', message: 'Unexpected parenthesis');
+        }
+        return 1;
+      }
+      if (methodCall.method == 'nativeEvaluate') {
+        final values = methodCall.arguments['values'] as List;
+        return {'val': values[0] * values[1] + 1, 'error': null};
+      }
+      if (methodCall.method == 'configureWorkerPool') {
+        return {
+          'poolSize': methodCall.arguments['poolSize'] ?? 4,
+          'maxQueueDepth': methodCall.arguments['maxQueueDepth'] ?? 65536,
+          'parallelism': methodCall.arguments['parallelism'] ?? 16,
+        };
+      }
+      if (methodCall.method == 'getStats') {
+        return {
+          'calls': 2,
+          'errors': 1,
+          'bytesIn': 10,
+          'bytesOut': 64,
+          'evaluate': {'count': 1, 'totalNs': 800, 'maxNs': 800, 'histogram': Int64List(40)},
+        };
+      }
+      if (methodCall.method == 'getCacheStats') {
+        return {'hits': 3, 'misses': 1, 'evictions': 0, 'size': 1, 'capacity': 512};
+      }
       return null;
     });
   });
@@ -19,4 +135,131 @@ void main() {
     ParsecLinux.registerWith();
     expect(ParsecPlatform.instance, isA<ParsecLinux>());
   });
+
+  test('evaluates into typed results without JSON decoding', () async {
+    final parsecLinux = ParsecLinux();
+
+    expect(await parsecLinux.nativeEval('1 / 2'), equals(0.5));
+    expect(parsecLinux.nativeEval('2 + )'), throwsA(isA<ParsecEvalException>()));
+  });
+
+  test('evaluates a batch keeping per-item errors in input order', () async {
+    final results = await ParsecLinux().nativeEvalBatch(['2 + 3', '2 + )', '10 / 2']);
+
+    expect(results, hasLength(3));
+    expect(results[0], equals(5));
+    expect(results[1], isA<ParsecEvalException>());
+    expect(results[1].toString(), equals('Unexpected parenthesis'));
+    expect(results[2], equals(5));
+  });
+
+  test('streams results in input order without exceeding the in-flight credits', () async {
+    final equations = Stream.fromIterable(['2 + 3', '2 + )', '10 / 2', '1 + 4', '7 - 2']);
+
+    await expectLater(
+      ParsecLinux().nativeEvalStream(equations, maxInFlight: 2),
+      emitsInOrder([
+        5,
+        emitsError(isA<ParsecEvalException>()),
+        5,
+        5,
+        5,
+        emitsDone,
+      ]),
+    );
+    expect(streamMaxInFlight, lessThanOrEqualTo(2));
+  });
+
+  test('evaluates a file of equations reporting progress and error counts', () async {
+    final parsecLinux = ParsecLinux();
+    final progress = <double>[];
+
+    final done = await parsecLinux.nativeEvalFile('/in.txt', '/out.bin',
+        format: ParsecRecordFormat.binary, onProgress: (counters) => progress.add(counters.fraction));
+
+    expect(done.lines, equals(100000));
+    expect(done.errors, equals(2));
+    expect(progress, equals([0.5]));
+    expect(
+      () => parsecLinux.nativeEvalFile('/missing.txt', '/out.jsonl'),
+      throwsA(isA<ParsecEvalException>()),
+    );
+  });
+
+  test('updates a sheet returning only the changed cells', () async {
+    final parsecLinux = ParsecLinux();
+    final id = await parsecLinux.nativeCreateSheet();
+
+    final changes = await parsecLinux.nativeUpdateSheet(id,
+        formulas: {'total': 'price * qty', 'loop': 'loop + 1'}, values: {'qty': 4});
+
+    expect(changes['qty'], equals(4));
+    expect(changes['total'], equals(10.0));
+    expect(changes['loop'], isA<ParsecEvalException>());
+    expect(changes.containsKey('price'), isFalse);
+  });
+
+  test('compiles a formula once and evaluates it with typed values', () async {
+    final parsecLinux = ParsecLinux();
+    final id = await parsecLinux.nativeCompile('x * y + 1', ['x', 'y']);
+
+    expect(id, equals(1));
+    expect(await parsecLinux.nativeEvaluate(id, [2, 3]), equals(7));
+    expect(await parsecLinux.nativeEvaluate(id, [0.5, 4]), equals(3.0));
+  });
+
+  test('reports invalid formulas on compile as ParsecEvalException', () async {
+    expect(
+      () => ParsecLinux().nativeCompile('2 + )', []),
+      throwsA(isA<ParsecEvalException>()),
+    );
+  });
+
+  test('evaluates a formula over columns with a per-row error bitmap', () async {
+    final result = await ParsecLinux().nativeEvalColumns('x * 2', {
+      'x': Float64List.fromList([1, 2, 3]),
+    });
+
+    expect(result.values, equals([2, 4, 6]));
+    expect(result.hasError(0), isFalse);
+    expect(result.hasError(1), isTrue);
+    expect(result.hasError(2), isFalse);
+  });
+
+  test('reads the native formula cache counters', () async {
+    final stats = await ParsecLinux().nativeGetCacheStats();
+
+    expect(stats['hits'], equals(3));
+    expect(stats['misses'], equals(1));
+    expect(stats['capacity'], equals(512));
+  });
+
+  test('configures the native worker pool leaving omitted values unchanged', () async {
+    final config = await ParsecLinux().nativeConfigureWorkerPool(poolSize: 2);
+
+    expect(config['poolSize'], equals(2));
+    expect(config['maxQueueDepth'], equals(65536));
+  });
+
+  test('rejects worker pool values the native side cannot honor', () async {
+    expect(ParsecLinux().nativeConfigureWorkerPool(poolSize: -1), throwsArgumentError);
+    expect(ParsecLinux().nativeConfigureWorkerPool(maxQueueDepth: 0), throwsArgumentError);
+    expect(ParsecLinux().nativeConfigureWorkerPool(parallelism: 0), throwsArgumentError);
+  });
+
+  test('configures how many threads split a large evaluation', () async {
+    final config = await ParsecLinux().nativeConfigureWorkerPool(parallelism: 8);
+
+    expect(config['parallelism'], equals(8));
+    expect(config['poolSize'], equals(4));
+  });
+
+  test('reads the native evaluation counters', () async {
+    final stats = await ParsecLinux().nativeGetStats();
+
+    expect(stats['calls'], equals(2));
+    expect(stats['errors'], equals(1));
+    expect(stats['evaluate']['maxNs'], equals(800));
+    expect(stats['evaluate']['histogram'], hasLength(40));
+  });
 }
@@ -3,6 +3,7 @@ import 'parsec_platform.dart';
 
 const _channelName = 'parsec_flutter';
 const _evalMethodName = 'nativeEval';
+const _evalBatchMethodName = 'nativeEvalBatch';
 
 /// Method channel implementation for native platform communication.
 /// 
@@ -19,4 +20,12 @@ class MethodChannelParsec extends ParsecPlatform {
 
     return _methodChannel.invokeMethod(_evalMethodName, {'equation': equation});
   }
+
+  @override
+  Future<List<dynamic>> nativeEvalBatch(List<String> equations) async {
+    final results = await _methodChannel.invokeListMethod<String>(
+        _evalBatchMethodName, {'equations': equations});
+
+    return parseNativeEvalBatchResult(results ?? const []);
+  }
 }
@@ -0,0 +1,17 @@
+import 'dart:typed_data';
+
+/// Result of evaluating one formula over numeric columns.
+///
+/// [values] holds one result per row. Rows that failed to evaluate hold NaN
+/// and are flagged in [errors], a bitmap with one bit per row.
+class ParsecColumnResult {
+  final Float64List values;
+  final Uint8List errors;
+
+  ParsecColumnResult(this.values, this.errors);
+
+  int get length => values.length;
+
+  /// Whether evaluating [row] failed.
+  bool hasError(int row) => (errors[row >> 3] & (1 << (row & 7))) != 0;
+}
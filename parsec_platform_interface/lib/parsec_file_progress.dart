@@ -0,0 +1,35 @@
+/// Layout of the result records written when evaluating a file of equations.
+enum ParsecRecordFormat {
+  /// One line per record with the same JSON text as a single evaluation.
+  json,
+
+  /// One binary record per equation: a type byte (`f`, `i`, `b`, `s`, or `e`
+  /// for errors) followed by the value in host byte order, an 8 byte double,
+  /// an 8 byte integer, a byte, or a 4 byte length and the UTF-8 bytes of the
+  /// text.
+  binary,
+}
+
+/// Counters of a file evaluation, reported as it progresses and once it is
+/// done.
+class ParsecFileProgress {
+  /// Lines evaluated so far, one record written for each.
+  final int lines;
+
+  /// Lines whose equation failed to evaluate.
+  final int errors;
+
+  /// Bytes of the input file read so far, out of [bytesTotal].
+  final int bytesRead;
+  final int bytesTotal;
+
+  ParsecFileProgress(this.lines, this.errors, this.bytesRead, this.bytesTotal);
+
+  /// Reads the counters from a `{lines, errors, bytesRead, bytesTotal}` map.
+  ParsecFileProgress.fromMap(Map<dynamic, dynamic> counters)
+      : this(counters['lines'], counters['errors'], counters['bytesRead'],
+            counters['bytesTotal']);
+
+  /// Fraction of the input evaluated so far, from 0 to 1.
+  double get fraction => bytesTotal == 0 ? 1 : bytesRead / bytesTotal;
+}
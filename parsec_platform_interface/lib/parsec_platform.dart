@@ -1,5 +1,8 @@
 import 'dart:convert';
+import 'dart:typed_data';
+import 'package:parsec_platform_interface/parsec_column_result.dart';
 import 'package:parsec_platform_interface/parsec_eval_exception.dart';
+import 'package:parsec_platform_interface/parsec_file_progress.dart';
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 import 'method_channel_parsec.dart';
 
@@ -28,6 +31,117 @@ abstract class ParsecPlatform extends PlatformInterface {
     throw UnimplementedError('nativeEval() has not been implemented.');
   }
 
+  /// Evaluates [equation] synchronously, in the calling isolate, on platforms
+  /// that can call the native library directly.
+  dynamic nativeEvalSync(String equation) {
+    throw UnimplementedError('nativeEvalSync() has not been implemented.');
+  }
+
+  /// Evaluates every equation of [equations] and returns the results in the
+  /// same order.
+  ///
+  /// A failed equation does not fail the whole batch: its slot holds the
+  /// [ParsecEvalException] describing the error instead of a value.
+  ///
+  /// Platforms that can evaluate a whole batch natively should override this
+  /// to cross the platform boundary only once. The default implementation
+  /// falls back to one [nativeEval] call per equation.
+  Future<List<dynamic>> nativeEvalBatch(List<String> equations) async {
+    final results = <dynamic>[];
+    for (final equation in equations) {
+      try {
+        results.add(await nativeEval(equation));
+      } on ParsecEvalException catch (error) {
+        results.add(error);
+      }
+    }
+    return results;
+  }
+
+  /// Evaluates the equations of [equations] as they arrive and emits their
+  /// results in the same order: the value of each equation, or a
+  /// [ParsecEvalException] error event for those that fail to evaluate.
+  ///
+  /// At most [maxInFlight] equations are being evaluated at any time; past
+  /// that, [equations] is paused until results come back. Platforms that can
+  /// stream evaluations natively should override this. The default
+  /// implementation evaluates one equation at a time with [nativeEval].
+  Stream<dynamic> nativeEvalStream(Stream<String> equations,
+      {int maxInFlight = 64}) {
+    return equations.asyncMap(nativeEval);
+  }
+
+  /// Evaluates [equation] once per row of [columns], a map from variable name
+  /// to a column of values. All columns must have the same length.
+  ///
+  /// Throws a [ParsecEvalException] when the equation is invalid; rows that
+  /// fail to evaluate are flagged in the returned [ParsecColumnResult].
+  Future<ParsecColumnResult> nativeEvalColumns(
+      String equation, Map<String, Float64List> columns) {
+    throw UnimplementedError('nativeEvalColumns() has not been implemented.');
+  }
+
+  /// Evaluates every line of the file at [inputPath] as an equation and
+  /// writes one result record per line, in [format], to the file at
+  /// [outputPath], without the equations crossing the platform boundary.
+  ///
+  /// [onProgress] is called with the counters as the evaluation progresses.
+  /// Returns the final counters. Throws a [ParsecEvalException] when a file
+  /// cannot be read or written; equations that fail to evaluate only get an
+  /// error record.
+  Future<ParsecFileProgress> nativeEvalFile(
+    String inputPath,
+    String outputPath, {
+    ParsecRecordFormat format = ParsecRecordFormat.json,
+    void Function(ParsecFileProgress progress)? onProgress,
+  }) {
+    throw UnimplementedError('nativeEvalFile() has not been implemented.');
+  }
+
+  /// Parses [formula] once on the native side, binding [variableNames] as its
+  /// variables, and returns the id of the compiled formula.
+  ///
+  /// Throws a [ParsecEvalException] when the formula is invalid.
+  Future<int> nativeCompile(String formula, List<String> variableNames) {
+    throw UnimplementedError('nativeCompile() has not been implemented.');
+  }
+
+  /// Evaluates the formula compiled under [formulaId] with [values] bound to
+  /// its variables, in the order they were given to [nativeCompile].
+  Future<dynamic> nativeEvaluate(int formulaId, List<dynamic> values) {
+    throw UnimplementedError('nativeEvaluate() has not been implemented.');
+  }
+
+  /// Frees the formula compiled under [formulaId].
+  Future<void> nativeDispose(int formulaId) {
+    throw UnimplementedError('nativeDispose() has not been implemented.');
+  }
+
+  /// Creates an empty native sheet of named cells and returns its id.
+  Future<int> nativeCreateSheet() {
+    throw UnimplementedError('nativeCreateSheet() has not been implemented.');
+  }
+
+  /// Changes the cells of the sheet under [sheetId]: removes the cells named
+  /// in [remove], then sets [formulas] and [values], both keyed by cell name.
+  ///
+  /// Only the cells affected by the changes are recalculated. Returns the
+  /// cells whose value changed, mapped to their new value, or to a
+  /// [ParsecEvalException] for those now in error.
+  Future<Map<String, dynamic>> nativeUpdateSheet(
+    int sheetId, {
+    Map<String, String>? formulas,
+    Map<String, dynamic>? values,
+    List<String>? remove,
+  }) {
+    throw UnimplementedError('nativeUpdateSheet() has not been implemented.');
+  }
+
+  /// Frees the sheet under [sheetId].
+  Future<void> nativeDisposeSheet(int sheetId) {
+    throw UnimplementedError('nativeDisposeSheet() has not been implemented.');
+  }
+
   dynamic parseNativeEvalResult(String jsonString) {
     var jsonData = jsonDecode(jsonString);
     var val = jsonData['val'];
@@ -60,4 +174,89 @@ abstract class ParsecPlatform extends PlatformInterface {
         return val;
     }
   }
+
+  /// Sets how many parsed formulas the native formula cache keeps. A
+  /// [capacity] of 0 disables the cache.
+  Future<void> nativeSetCacheCapacity(int capacity) {
+    throw UnimplementedError('nativeSetCacheCapacity() has not been implemented.');
+  }
+
+  /// Returns the counters of the native formula cache: `hits`, `misses`,
+  /// `evictions`, `size` and `capacity`.
+  Future<Map<String, int>> nativeGetCacheStats() {
+    throw UnimplementedError('nativeGetCacheStats() has not been implemented.');
+  }
+
+  /// Returns the native evaluation counters: `calls`, `errors`, `bytesIn`,
+  /// `bytesOut`, an `optimizer` map with the number of `formulas` the
+  /// optimizer rewrote, the RPN `nodesRemoved` from them and the number of
+  /// `numericFormulas` running on the numeric engine, an `arena` map with the
+  /// `chunks` and `bytes` the evaluation arenas hold from the heap, which are
+  /// not reset, and the `oversized` requests too large for their chunks, and
+  /// for each of the `parse`, `evaluate` and `serialize` phases a map with its `count`, `totalNs`, `maxNs` and a log2 latency
+  /// `histogram`, where bucket i counts the times in [2^(i-1), 2^i) ns.
+  Future<Map<String, dynamic>> nativeGetStats() {
+    throw UnimplementedError('nativeGetStats() has not been implemented.');
+  }
+
+  /// Sets every native evaluation counter back to zero.
+  Future<void> nativeResetStats() {
+    throw UnimplementedError('nativeResetStats() has not been implemented.');
+  }
+
+  /// Loads whatever the first evaluation would otherwise wait for, such as a
+  /// WebAssembly module, and returns how long each phase of the load took in
+  /// milliseconds. Platforms loading their library with the app have nothing
+  /// to load and return an empty map.
+  Future<Map<String, dynamic>> nativeWarmUp() async {
+    return const {};
+  }
+
+  /// Configures the native worker pool evaluating equations off the platform
+  /// thread: [poolSize] worker threads, 0 meaning evaluations run on the
+  /// platform thread, and at most [maxQueueDepth] evaluations waiting for a
+  /// free worker. [parallelism] threads split a single large batch or columns
+  /// evaluation across cores, 1 disabling the splitting. Omitted values are
+  /// left unchanged.
+  ///
+  /// Returns the resulting `poolSize`, `maxQueueDepth` and `parallelism`.
+  Future<Map<String, int>> nativeConfigureWorkerPool({
+    int? poolSize,
+    int? maxQueueDepth,
+    int? parallelism,
+  }) {
+    throw UnimplementedError('nativeConfigureWorkerPool() has not been implemented.');
+  }
+
+  /// Parses a typed `{'val': ..., 'error': ...}` result, where the native side
+  /// already sent the value as an int, double, bool or string.
+  dynamic parseNativeTypedResult(Map<dynamic, dynamic> result) {
+    var error = result['error'];
+
+    if (error != null) {
+      throw ParsecEvalException(error);
+    }
+
+    return result['val'];
+  }
+
+  List<dynamic> parseNativeEvalBatchResult(List<dynamic> jsonStrings) {
+    return jsonStrings.map((jsonString) {
+      try {
+        return parseNativeEvalResult(jsonString as String);
+      } on ParsecEvalException catch (error) {
+        return error;
+      }
+    }).toList();
+  }
+
+  List<dynamic> parseNativeTypedBatchResult(List<dynamic> results) {
+    return results.map((result) {
+      try {
+        return parseNativeTypedResult(result as Map<dynamic, dynamic>);
+      } on ParsecEvalException catch (error) {
+        return error;
+      }
+    }).toList();
+  }
 }
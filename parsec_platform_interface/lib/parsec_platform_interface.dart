@@ -1 +1,3 @@
+export 'parsec_column_result.dart';
+export 'parsec_file_progress.dart';
 export 'parsec_platform.dart';
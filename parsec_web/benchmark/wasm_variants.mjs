@@ -0,0 +1,93 @@
+// Headless benchmark of the WebAssembly builds of equations-parser, run under Node.
+//
+// Each build generated by `dart run parsec_web:generate` is loaded and measured on two workloads:
+//   numeric  evaluating numeric formulas one evalBatchRaw call at a time, as nativeEval does
+//   batch    evaluating kBatchSize formulas of the corpus in a single evalBatchRaw call, as
+//            nativeEvalBatch does; the threads build splits it across its pthread pool
+// and reported in microseconds per formula, with the speedup over the baseline build.
+//
+// Usage: node benchmark/wasm_variants.mjs [--iterations N]
+// Exits with a non-zero status if a build returns different results from the baseline one.
+import { existsSync } from 'node:fs';
+
+const variants = ['baseline', 'simd', 'threads'];
+const kBatchSize = 20000;
+
+const numericCorpus = [
+  '2 + 3 * sin(pi / 2)',
+  'sqrt(16) * 4 ^ 2 - 1',
+  'log(10) + exp(2) / cos(0.5)',
+  '((1 + 2) * (3 + 4) / 5) ^ 2 - round(2.567, 2)',
+  'abs(-12.5) + max(1, 2, 3) * min(4, 5, 6)',
+];
+const corpus = [
+  ...numericCorpus,
+  'concat("Hello ", "World")',
+  '5 > 3 ? "yes" : "no"',
+  'toupper("test string")',
+  '1 + )',
+];
+
+const iterationsFlag = process.argv.indexOf('--iterations');
+const iterations = iterationsFlag > 0 ? Number(process.argv[iterationsFlag + 1]) : 2000;
+
+function pack(equations) {
+  return equations.map((equation) => equation + '\0').join('');
+}
+
+function measure(run) {
+  run();  // warm up
+  const start = process.hrtime.bigint();
+  const count = run();
+  return Number(process.hrtime.bigint() - start) / 1000 / count;
+}
+
+const batch = pack(Array.from({ length: kBatchSize }, (_, i) => corpus[i % corpus.length]));
+const rows = [];
+let expected;
+let failed = false;
+
+for (const variant of variants) {
+  const name = variant === 'baseline' ? 'equations_parser' : `equations_parser_${variant}`;
+  const glue = new URL(`../lib/parsec-web/wasm/${name}.js`, import.meta.url);
+  if (!existsSync(glue)) {
+    console.log(`${variant}: not built, skipped`);
+    continue;
+  }
+
+  const { default: EquationsModule } = await import(glue);
+  const module = await EquationsModule();
+
+  const results = module.evalBatchRaw(batch);
+  expected ??= results;
+  if (results !== expected) {
+    console.error(`${variant}: results differ from the baseline build`);
+    failed = true;
+  }
+
+  const numeric = measure(() => {
+    for (let i = 0; i < iterations; i++) {
+      module.evalBatchRaw(numericCorpus[i % numericCorpus.length] + '\0');
+    }
+    return iterations;
+  });
+  const batched = measure(() => {
+    module.evalBatchRaw(batch);
+    return kBatchSize;
+  });
+  rows.push({ variant, numeric, batch: batched });
+
+  // Lets the pthread pool of the threads build exit with the process
+  module.PThread?.terminateAllThreads?.();
+}
+
+const baseline = rows.find((row) => row.variant === 'baseline');
+console.log('variant   numeric us/formula        batch us/formula');
+for (const row of rows) {
+  const speedup = (workload) => (baseline ? ` (${(baseline[workload] / row[workload]).toFixed(2)}x)` : '');
+  console.log(
+    `${row.variant.padEnd(9)} ${(row.numeric.toFixed(3) + speedup('numeric')).padEnd(24)} ` +
+      `${row.batch.toFixed(3)}${speedup('batch')}`,
+  );
+}
+process.exit(failed ? 1 : 0);
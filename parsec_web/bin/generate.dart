@@ -9,7 +9,8 @@ import 'dart:async';
 /// by performing the same operations in Dart:
 /// 1. Checks for parsec-web submodule
 /// 2. Builds WebAssembly files using Emscripten if needed
-/// 3. Verifies all required files are present
+/// 3. Writes the build id of each WebAssembly file
+/// 4. Verifies all required files are present
 
 Future<void> main(List<String> args) async {
   final generator = ParsecWebGenerator();
@@ -20,7 +21,28 @@ class ParsecWebGenerator {
   static const String parsecWebPath = 'lib/parsec-web';
   static const String wasmOutputPath = '$parsecWebPath/wasm';
   static const String wasmOutputFile = '$wasmOutputPath/equations_parser.js';
-  static const String jsWrapperFile = '$parsecWebPath/js/equations_parser_wrapper.js';
+  static const String loaderFile = 'lib/js/parsec_wasm_loader.js';
+  // Hash of each built module by file name, which lib/js/parsec_wasm_loader.js
+  // keys its cache of compiled modules on
+  static const String buildIdsFile = '$wasmOutputPath/build_ids.json';
+  // Exports of this package compiled into the module, relative to parsecWebPath
+  static const String batchSourceFile = '../../cpp/parsec_batch.cpp';
+  // Threads splitting a large evalBatchRaw call in the threads variant, all
+  // started with the module so none has to be spawned while the caller waits
+  static const int batchThreads = 4;
+  // Extra emcc flags of each build of the module, by the suffix of its files:
+  // the baseline build, and the variants lib/js/parsec_wasm_loader.js picks
+  // when the runtime supports them.
+  static const Map<String, List<String>> wasmVariants = {
+    '': [],
+    '_simd': ['-msimd128'],
+    '_threads': [
+      '-msimd128',
+      '-pthread',
+      '-s', 'PTHREAD_POOL_SIZE=$batchThreads',
+      '-DPARSEC_BATCH_THREADS=$batchThreads',
+    ],
+  };
   
   Future<void> generate() async {
     print('🔧 Generating parsec-web WebAssembly assets...');
@@ -29,15 +51,16 @@ class ParsecWebGenerator {
     try {
       await _checkSubmoduleExists();
       await _buildWasmFilesIfNeeded();
+      await _writeBuildIds();
       await _verifyRequiredFiles();
       
       print('');
       print('✅ Generation complete!');
       print('');
       print('📋 Next steps:');
-      print('1. Ensure your app\'s web/index.html includes:');
-      print('   <script type="module" src="packages/parsec_web/parsec-web/js/equations_parser_wrapper.js"></script>');
-      print('   <!-- WASM glue is loaded dynamically by the wrapper (../wasm/equations_parser.js). -->');
+      print('1. Nothing to add to your app\'s web/index.html: the plugin imports');
+      print('   packages/parsec_web/js/parsec_wasm_loader.js, which loads the best');
+      print('   WASM build the browser supports from packages/parsec_web/parsec-web/wasm/.');
       print('');
       print('2. Run Flutter web: cd parsec/example && flutter run -d chrome');
       print('');
@@ -68,9 +91,16 @@ class ParsecWebGenerator {
   Future<void> _buildWasmFilesIfNeeded() async {
     print('🔧 Checking WASM files...');
     
-    final wasmFile = File(wasmOutputFile);
-    if (await wasmFile.exists()) {
-      print('✅ WASM file already exists: $wasmOutputFile');
+    final missingVariants = <String>[];
+    for (final suffix in wasmVariants.keys) {
+      final glue = File('$wasmOutputPath/equations_parser$suffix.js');
+      final binary = File('$wasmOutputPath/equations_parser$suffix.wasm');
+      if (!await glue.exists() || !await binary.exists()) {
+        missingVariants.add(suffix);
+      }
+    }
+    if (missingVariants.isEmpty) {
+      print('✅ WASM files already exist in: $wasmOutputPath');
       return;
     }
     
@@ -82,7 +112,7 @@ class ParsecWebGenerator {
       return;
     }
     
-    await _runBuildScript();
+    await _runBuildScript(missingVariants);
   }
   
   Future<bool> _isEmscriptenAvailable() async {
@@ -94,7 +124,7 @@ class ParsecWebGenerator {
     }
   }
   
-  Future<void> _runBuildScript() async {
+  Future<void> _runBuildScript(List<String> variants) async {
     print('🔧 Compiling with Emscripten...');
     
     // Create wasm output directory if it doesn't exist
@@ -111,11 +141,21 @@ class ParsecWebGenerator {
     
     final List<String> sources = [
       'cpp/equations_parser_wrapper.cpp',
+      batchSourceFile,
       ...cppFiles.map((f) => f.path.replaceFirst('$parsecWebPath/', '')),
     ];
     
     print('📋 Found equations-parser sources: ${cppFiles.length} files');
     
+    for (final suffix in variants) {
+      await _buildVariant(sources, suffix);
+    }
+  }
+  
+  Future<void> _buildVariant(List<String> sources, String suffix) async {
+    final output = 'wasm/equations_parser$suffix.js';
+    print('🔧 Building ${suffix.isEmpty ? 'baseline' : suffix.substring(1)} variant...');
+    
     // Build emcc command
     final List<String> emccArgs = [
       ...sources,
@@ -128,9 +168,11 @@ class ParsecWebGenerator {
       '-s', 'EXPORT_ES6=1',
       '--bind',
       '-O3',
-      '-s', 'ENVIRONMENT=web',
-      '-s', 'SINGLE_FILE=1',
-      '-o', 'wasm/equations_parser.js',
+      // worker lets lib/js/parsec_worker.js load the module, and node
+      // test/eval_batch_raw_test.mjs, headless
+      '-s', 'ENVIRONMENT=web,worker,node',
+      ...wasmVariants[suffix]!,
+      '-o', output,
     ];
     
     final process = await Process.run('emcc', emccArgs, workingDirectory: parsecWebPath);
@@ -140,19 +182,45 @@ class ParsecWebGenerator {
     }
     
     print('✅ Build successful!');
-    final wasmFile = File(wasmOutputFile);
-    final stats = await wasmFile.stat();
-    print('Generated file: $wasmOutputFile (${_formatFileSize(stats.size)})');
+    for (final extension in ['js', 'wasm']) {
+      final path = '$wasmOutputPath/equations_parser$suffix.$extension';
+      final stats = await File(path).stat();
+      print('Generated file: $path (${_formatFileSize(stats.size)})');
+    }
+  }
+  
+  Future<void> _writeBuildIds() async {
+    final ids = <String, String>{};
+    for (final suffix in wasmVariants.keys) {
+      final binary = File('$wasmOutputPath/equations_parser$suffix.wasm');
+      if (!await binary.exists()) continue;
+      ids['equations_parser$suffix.wasm'] = _hash(await binary.readAsBytes());
+    }
+    if (ids.isEmpty) return;
+    
+    final entries = ids.entries.map((entry) => '  "${entry.key}": "${entry.value}"');
+    await File(buildIdsFile).writeAsString('{\n${entries.join(',\n')}\n}\n');
+    print('✅ Build ids written to: $buildIdsFile');
+  }
+  
+  // 64-bit FNV-1a of [bytes] as hex, enough to tell builds apart
+  String _hash(List<int> bytes) {
+    var hash = 0xcbf29ce484222325;
+    for (final byte in bytes) {
+      hash ^= byte;
+      hash *= 0x100000001b3;
+    }
+    return hash.toUnsigned(64).toRadixString(16).padLeft(16, '0');
   }
   
   Future<void> _verifyRequiredFiles() async {
     print('📁 Verifying required files...');
     
-    final jsWrapper = File(jsWrapperFile);
-    if (await jsWrapper.exists()) {
-      print('✅ JavaScript wrapper found at: $jsWrapperFile');
+    final loader = File(loaderFile);
+    if (await loader.exists()) {
+      print('✅ WASM loader found at: $loaderFile');
     } else {
-      throw Exception('JavaScript wrapper missing at: $jsWrapperFile');
+      throw Exception('WASM loader missing at: $loaderFile');
     }
     
     final wasmGlue = File(wasmOutputFile);
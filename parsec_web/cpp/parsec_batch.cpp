@@ -0,0 +1,98 @@
+#include <emscripten/bind.h>
+
+#include <string>
+
+#ifdef PARSEC_BATCH_THREADS
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+#include "equationsParser.h"
+
+using namespace std;
+
+namespace {
+
+// Separates the formulas of a batch, and their results. Neither formulas nor CalcJson results
+// contain it, and embind passes it through strings unchanged.
+constexpr char kSeparator = '\0';
+
+#ifdef PARSEC_BATCH_THREADS
+// Below this many formulas, starting threads costs more than they save.
+constexpr size_t kMinThreadedFormulas = 256;
+
+// Serializes the CalcJson calls. equations-parser and muparserx have not been checked for static
+// mutable state, like lazily built operator tables or the static buffer of localtime() the date
+// functions may use, so concurrent calls are not known to be safe. Until they are, the threads
+// only overlap splitting the batch and concatenating the results.
+mutex calc_json_mutex;
+#endif
+
+// Appends the CalcJson result of every formula of packed[begin, end), each followed by
+// kSeparator, to @p results. @p begin and @p end are formula boundaries.
+void EvalRange(const string &packed, size_t begin, size_t end, string &results) {
+  size_t position = begin;
+  while (position < end) {
+    size_t next = packed.find(kSeparator, position);
+    if (next == string::npos || next > end) next = end;
+
+    string formula = packed.substr(position, next - position);
+    {
+#ifdef PARSEC_BATCH_THREADS
+      lock_guard<mutex> lock(calc_json_mutex);
+#endif
+      results += EquationsParser::CalcJson(formula);
+    }
+    results += kSeparator;
+    position = next + 1;
+  }
+}
+
+/**
+ * @brief Evaluates every formula of @p packed, a batch of formulas each followed by kSeparator,
+ * and returns their CalcJson results in the same layout and order.
+ *
+ * The whole batch crosses the JS/WASM boundary once each way, instead of once per formula. In the
+ * threads build, large batches are split in PARSEC_BATCH_THREADS ranges of about the same size,
+ * evaluated by the calling thread and threads of the pthread pool, one CalcJson call at a time.
+ */
+string EvalBatchRaw(const string &packed) {
+  string results;
+
+#ifdef PARSEC_BATCH_THREADS
+  if (static_cast<size_t>(count(packed.begin(), packed.end(), kSeparator)) >=
+      kMinThreadedFormulas) {
+    vector<size_t> bounds{0};
+    for (size_t i = 1; i < PARSEC_BATCH_THREADS; i++) {
+      size_t target = max(bounds.back(), packed.size() * i / PARSEC_BATCH_THREADS);
+      size_t split = packed.find(kSeparator, target);
+      if (split == string::npos) break;
+      bounds.push_back(split + 1);
+    }
+    bounds.push_back(packed.size());
+
+    vector<string> parts(bounds.size() - 1);
+    vector<thread> threads;
+    for (size_t i = 1; i < parts.size(); i++) {
+      threads.emplace_back(EvalRange, cref(packed), bounds[i], bounds[i + 1], ref(parts[i]));
+    }
+    EvalRange(packed, bounds[0], bounds[1], parts[0]);
+    for (thread &worker : threads) worker.join();
+
+    for (const string &part : parts) results += part;
+    return results;
+  }
+#endif
+
+  EvalRange(packed, 0, packed.size(), results);
+  return results;
+}
+
+}  // namespace
+
+EMSCRIPTEN_BINDINGS(parsec_batch) {
+  emscripten::function("evalBatchRaw", &EvalBatchRaw);
+}
@@ -0,0 +1,195 @@
+// Loads the equations-parser WebAssembly module for ParsecWebPlugin and its workers.
+//
+// The best build the runtime supports is loaded: the SIMD one where WebAssembly SIMD is, and the
+// baseline one otherwise or when a variant fails to load. The threads build is only loaded when
+// passed to loadEquationsModule by name: its threads take turns evaluating, so it is no faster
+// than the SIMD one.
+//
+// The module is compiled while it downloads, and the compiled module is kept in IndexedDB so
+// later visits skip both the download and the compilation. Browsers that cannot store compiled
+// modules still reuse their own code cache for streamed compilations.
+//
+// Compiled modules are keyed on the build id bin/generate.dart writes for each .wasm file, or the
+// ETag or Last-Modified header the server sends for it, so a rebuilt module is never served from
+// an older compilation. Without any of them the module is not kept.
+
+const buildIdsFile = 'build_ids.json';
+const databaseName = 'parsec_web';
+const storeName = 'modules';
+
+// A module using a SIMD instruction, which only validates where WebAssembly SIMD is supported.
+const simdProbe = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15,
+  253, 98, 11,
+]);
+
+// Names of the builds the runtime supports, best first; the baseline one is always last. The
+// threads build is left out, see above.
+export function supportedVariants() {
+  const variants = [];
+  if (WebAssembly.validate(simdProbe)) variants.push('simd');
+  variants.push('baseline');
+  return variants;
+}
+
+// Resolves to {module, timings}: the Emscripten module, and how long fetching, compiling and
+// instantiating it took in milliseconds, with `cached` set when the compiled module came from
+// IndexedDB and `variant` naming the build loaded.
+export async function loadEquationsModule(variants = supportedVariants()) {
+  let lastError;
+  for (const variant of variants) {
+    try {
+      return await loadVariant(variant);
+    } catch (error) {
+      lastError = error;
+    }
+  }
+  throw lastError;
+}
+
+async function loadVariant(variant) {
+  const name = variant === 'baseline' ? 'equations_parser' : `equations_parser_${variant}`;
+  const glueUrl = new URL(`../parsec-web/wasm/${name}.js`, import.meta.url).href;
+  const wasmUrl = new URL(`../parsec-web/wasm/${name}.wasm`, import.meta.url).href;
+  const { default: EquationsModule } = await import(glueUrl);
+
+  const timings = { fetch: 0, compile: 0, instantiate: 0, cached: false, variant };
+
+  // Emscripten waits for receiveInstance forever if the instantiation fails, so failures race it.
+  let fail;
+  const failure = new Promise((_, reject) => { fail = reject; });
+
+  const module = await Promise.race([
+    EquationsModule({
+      instantiateWasm(imports, receiveInstance) {
+        instantiateModule(wasmUrl, imports, timings)
+          .then(({ instance, compiled }) => receiveInstance(instance, compiled))
+          .catch(fail);
+        return {};
+      },
+    }),
+    failure,
+  ]);
+  return { module, timings };
+}
+
+// Instantiates the module at wasmUrl, compiled from IndexedDB if possible. A cached module failing
+// to instantiate, stored by another browser version or for other imports, is dropped and the
+// module fetched and compiled again.
+async function instantiateModule(wasmUrl, imports, timings) {
+  const cacheKey = await moduleCacheKey(wasmUrl);
+  const cached = cacheKey && (await readCachedModule(cacheKey));
+  if (cached) {
+    try {
+      const instance = await instantiateTimed(cached, imports, timings);
+      timings.cached = true;
+      return { instance, compiled: cached };
+    } catch (_) {
+      deleteCachedModule(cacheKey);
+    }
+  }
+
+  const compiled = await fetchModule(wasmUrl, timings);
+  const instance = await instantiateTimed(compiled, imports, timings);
+  if (cacheKey) cacheModule(wasmUrl, cacheKey, compiled);
+  return { instance, compiled };
+}
+
+async function instantiateTimed(compiled, imports, timings) {
+  const start = performance.now();
+  const instance = await WebAssembly.instantiate(compiled, imports);
+  timings.instantiate = performance.now() - start;
+  return instance;
+}
+
+// Build ids by .wasm file name, fetched once for all the variants.
+let buildIds;
+
+// Resolves to the IndexedDB key of the module at wasmUrl, or null if its build cannot be told
+// apart from another one.
+async function moduleCacheKey(wasmUrl) {
+  buildIds ??= fetch(new URL(buildIdsFile, wasmUrl), { cache: 'no-cache' })
+    .then((response) => (response.ok ? response.json() : {}))
+    .catch(() => ({}));
+  const fileName = new URL(wasmUrl).pathname.split('/').pop();
+  const buildId = (await buildIds)[fileName];
+  if (buildId) return `${wasmUrl}#${buildId}`;
+
+  try {
+    const response = await fetch(wasmUrl, { method: 'HEAD', cache: 'no-cache' });
+    const validator = response.headers.get('ETag') ?? response.headers.get('Last-Modified');
+    return response.ok && validator ? `${wasmUrl}#${validator}` : null;
+  } catch (_) {
+    return null;
+  }
+}
+
+async function fetchModule(wasmUrl, timings) {
+  let start = performance.now();
+  const response = await fetch(wasmUrl);
+  if (!response.ok) throw new Error(`Failed to fetch ${wasmUrl}: ${response.status}`);
+  // Up to the response headers: the body downloads while it compiles.
+  timings.fetch = performance.now() - start;
+
+  start = performance.now();
+  let compiled;
+  try {
+    compiled = await WebAssembly.compileStreaming(response.clone());
+  } catch (_) {
+    // Served without the application/wasm content type
+    compiled = await WebAssembly.compile(await response.arrayBuffer());
+  }
+  timings.compile = performance.now() - start;
+  return compiled;
+}
+
+function openDatabase() {
+  return new Promise((resolve, reject) => {
+    const request = indexedDB.open(databaseName, 1);
+    request.onupgradeneeded = () => request.result.createObjectStore(storeName);
+    request.onsuccess = () => resolve(request.result);
+    request.onerror = () => reject(request.error);
+  });
+}
+
+async function readCachedModule(cacheKey) {
+  if (typeof indexedDB === 'undefined') return null;
+  try {
+    const database = await openDatabase();
+    return await new Promise((resolve) => {
+      const request = database.transaction(storeName).objectStore(storeName).get(cacheKey);
+      request.onsuccess = () => {
+        resolve(request.result instanceof WebAssembly.Module ? request.result : null);
+      };
+      request.onerror = () => resolve(null);
+    });
+  } catch (_) {
+    return null;
+  }
+}
+
+// Stores the module compiled from wasmUrl under cacheKey, dropping those of its other builds.
+async function cacheModule(wasmUrl, cacheKey, compiled) {
+  if (typeof indexedDB === 'undefined') return;
+  try {
+    const database = await openDatabase();
+    const store = database.transaction(storeName, 'readwrite').objectStore(storeName);
+    store.openCursor().onsuccess = ({ target: { result: cursor } }) => {
+      if (!cursor) return;
+      if (cursor.key.startsWith(`${wasmUrl}#`) && cursor.key !== cacheKey) cursor.delete();
+      cursor.continue();
+    };
+    store.put(compiled, cacheKey);
+  } catch (_) {
+    // Storing a compiled module throws a DataCloneError where the browser does not support it.
+  }
+}
+
+async function deleteCachedModule(cacheKey) {
+  try {
+    const database = await openDatabase();
+    database.transaction(storeName, 'readwrite').objectStore(storeName).delete(cacheKey);
+  } catch (_) {
+    // Left for the next successful load to replace.
+  }
+}
@@ -0,0 +1,28 @@
+// Web Worker evaluating equations with its own instance of the equations-parser WebAssembly
+// module, so ParsecWebPlugin can keep evaluations off the main thread.
+//
+// Requests are {id, packed}, packed holding equations each followed by a NUL character as
+// evalBatchRaw takes them. Replies are {id, packed} with the CalcJson results in the same layout,
+// or {id, error} if the module could not be loaded or the evaluation threw.
+import { loadEquationsModule } from './parsec_wasm_loader.js';
+
+const ready = loadEquationsModule();
+
+self.onmessage = async ({ data: { id, packed } }) => {
+  let module;
+  try {
+    ({ module } = await ready);
+  } catch (error) {
+    self.postMessage({ id, error: `Failed to initialize Parsec WebAssembly module: ${error}` });
+    return;
+  }
+  let results;
+  try {
+    results = module.evalBatchRaw(packed);
+  } catch (error) {
+    // An abort or an out of memory error, which would otherwise leave the request pending forever
+    self.postMessage({ id, error: `Parsec WebAssembly evaluation failed: ${error}` });
+    return;
+  }
+  self.postMessage({ id, packed: results });
+};
@@ -1,132 +1,257 @@
 import 'dart:async';
 import 'dart:convert';
 import 'dart:js_interop';
-import 'dart:js_util' as js_util;
 
+import 'package:flutter/services.dart';
 import 'package:flutter_web_plugins/flutter_web_plugins.dart';
 import 'package:parsec_platform_interface/parsec_platform_interface.dart';
 import 'package:web/web.dart' as web;
 
+import 'parsec_web_worker_pool.dart';
+
 /// Web implementation of the parsec plugin using WebAssembly
 /// 
-/// Provides equation evaluation through the parsec-web JavaScript library
-/// that wraps the equations-parser WebAssembly module for optimal performance.
+/// Provides equation evaluation through the equations-parser WebAssembly
+/// module, loaded by `lib/js/parsec_wasm_loader.js` on the main thread and in
+/// each Web Worker.
 class ParsecWebPlugin extends ParsecPlatform {
   ParsecWebPlugin();
 
+  /// Follows every equation, and every result, of a packed `evalBatchRaw`
+  /// buffer.
+  static const _batchSeparator = '\u0000';
+
   static void registerWith(Registrar registrar) {
     ParsecPlatform.instance = ParsecWebPlugin();
   }
 
-  ParsecJS? _parsecInstance;
-  bool _isInitialized = false;
+  /// Loader of the WebAssembly module, shipped in `lib/js` of this package.
+  static const _loaderUrl = 'packages/parsec_web/js/parsec_wasm_loader.js';
+
+  _EquationsModule? _module;
+  Future<void>? _initialization;
+  Map<String, dynamic> _initTimings = const {};
 
-  bool get isInitialized => _isInitialized;
+  ParsecWebWorkerPool? _workers;
+  int _maxQueueDepth = 65536;
+  int _parallelism = web.window.navigator.hardwareConcurrency;
+
+  bool get isInitialized => _module != null;
 
   @override
   Future<dynamic> nativeEval(String equation) async {
     _validateEquation(equation);
-    
+    final workers = _workersWithRoom();
+
     try {
-      await _ensureParsecInitialized();
-      
-      // Use evalRaw() which returns the raw JSON from C++
-      final jsonResult = _parsecInstance!.evalRaw(equation);
+      final String jsonResult;
+      if (workers != null) {
+        jsonResult = (await workers.evaluate([equation])).single;
+      } else {
+        await _ensureParsecInitialized();
+        jsonResult = _evalBatchRaw([equation]).single;
+      }
       return parseNativeEvalResult(jsonResult);
     } catch (error) {
       return _handleEvaluationError(error);
     }
   }
 
+  /// Evaluates all [equations] with a single call into the WebAssembly module.
+  /// With web workers, the batch is split across up to `parallelism` of them
+  /// instead. An equation nativeEval would reject, empty or holding a NUL
+  /// character, is not evaluated and gets its error in its own slot.
+  @override
+  Future<List<dynamic>> nativeEvalBatch(List<String> equations) async {
+    final workers = _workersWithRoom();
+    final errors = [for (final equation in equations) _equationError(equation)];
+    final valid = [
+      for (var i = 0; i < equations.length; i++)
+        if (errors[i] == null) equations[i],
+    ];
 
-  void _validateEquation(String equation) {
-    if (equation.trim().isEmpty) {
-      throw ArgumentError.value(equation, 'equation', 'Equation cannot be empty');
+    try {
+      final List<String> validResults;
+      if (valid.isEmpty) {
+        validResults = [];
+      } else if (workers != null) {
+        validResults = await workers.evaluate(valid, slices: _parallelism);
+      } else {
+        await _ensureParsecInitialized();
+        validResults = _evalBatchRaw(valid);
+      }
+
+      final results = validResults.iterator;
+      final jsonResults = [
+        for (final error in errors)
+          error == null ? (results..moveNext()).current : _errorJson(error),
+      ];
+      return parseNativeEvalBatchResult(jsonResults);
+    } catch (error) {
+      // Throws the ParsecEvalException nativeEval would
+      _handleEvaluationError(error);
+      rethrow;
     }
   }
 
-  Future<void> _ensureParsecInitialized() async {
-    if (!_isInitialized) {
-      await _initializeParsec();
+  /// Loads the WebAssembly module on the main thread, and in every Web Worker
+  /// when there are some, unless it already is. Returns how long each phase
+  /// of the main thread load took, in milliseconds: `fetch`, `compile`,
+  /// `instantiate` and `firstEval`, with `cached` telling whether the
+  /// compiled module came from IndexedDB and `variant` which build was loaded:
+  /// `simd` or `baseline`.
+  @override
+  Future<Map<String, dynamic>> nativeWarmUp() async {
+    final workers = _workers;
+    await Future.wait([
+      _ensureParsecInitialized(),
+      if (workers != null) workers.warmUp(),
+    ]);
+    return _initTimings;
+  }
+
+  /// Web Workers stand for the native worker threads here: [poolSize]
+  /// workers, each loading its own WebAssembly module, evaluate equations off
+  /// the main thread, and 0, the default, evaluates them on the main thread.
+  /// [parallelism] workers split a single batch. Reducing the pool lets the
+  /// dropped workers answer their requests in flight before terminating.
+  @override
+  Future<Map<String, int>> nativeConfigureWorkerPool({
+    int? poolSize,
+    int? maxQueueDepth,
+    int? parallelism,
+  }) async {
+    if (poolSize != null && poolSize < 0) {
+      throw ArgumentError.value(poolSize, 'poolSize', 'must not be negative');
     }
-    
-    if (_parsecInstance == null) {
-      throw Exception('Parsec WebAssembly module failed to initialize');
+    if (maxQueueDepth != null && maxQueueDepth < 1) {
+      throw ArgumentError.value(maxQueueDepth, 'maxQueueDepth', 'must be positive');
+    }
+    if (parallelism != null && parallelism < 1) {
+      throw ArgumentError.value(parallelism, 'parallelism', 'must be positive');
     }
-  }
 
+    if (poolSize != null && poolSize != (_workers?.size ?? 0)) {
+      _workers?.close();
+      _workers = poolSize == 0 ? null : ParsecWebWorkerPool(poolSize);
+    }
+    if (maxQueueDepth != null) _maxQueueDepth = maxQueueDepth;
+    if (parallelism != null) _parallelism = parallelism;
 
-  dynamic _handleEvaluationError(Object error) {
-    final Map<String, dynamic> result = {
-      'val': null,
-      'type': null,
-      'error': error.toString(),
+    return {
+      'poolSize': _workers?.size ?? 0,
+      'maxQueueDepth': _maxQueueDepth,
+      'parallelism': _parallelism,
     };
-    final errorJsonResult = jsonEncode(result);
-    return parseNativeEvalResult(errorJsonResult);
   }
 
-  Future<void> _initializeParsec() async {
-    if (_isInitialized) return;
+  /// Returns the web workers, or null when evaluating on the main thread.
+  ParsecWebWorkerPool? _workersWithRoom() {
+    final workers = _workers;
+    if (workers != null && workers.inFlight >= _maxQueueDepth) {
+      throw PlatformException(
+        code: 'queue_full',
+        message: 'Too many evaluations are waiting for a worker',
+      );
+    }
+    return workers;
+  }
 
-    _validateWebLibraryAvailability();
-    await _createAndInitializeParsecInstance();
-    _isInitialized = true;
+  /// Callers validate [equations] first: a NUL character inside one would
+  /// split it in two.
+  List<String> _evalBatchRaw(List<String> equations) {
+    assert(!equations.any((equation) => equation.contains(_batchSeparator)));
+    final packed =
+        equations.map((equation) => '$equation$_batchSeparator').join();
+    return _module!.evalBatchRaw(packed).split(_batchSeparator)..removeLast();
   }
 
-  void _validateWebLibraryAvailability() {
-    if (!_isParseWebLibraryAvailable()) {
-      throw Exception(_getLibraryNotFoundMessage());
-    }
+  void _validateEquation(String equation) {
+    final error = _equationError(equation);
+    if (error != null) throw ArgumentError.value(equation, 'equation', error);
   }
 
-  Future<void> _createAndInitializeParsecInstance() async {
-    try {
-      _parsecInstance = ParsecJS();
-      await _parsecInstance!.initialize('../wasm/equations_parser.js').toDart;
-    } catch (error) {
-      throw Exception('Failed to initialize Parsec WebAssembly module: $error');
+  /// Returns why [equation] cannot be evaluated, or null if it can. NUL
+  /// characters separate the equations of a packed batch.
+  static String? _equationError(String equation) {
+    if (equation.trim().isEmpty) return 'Equation cannot be empty';
+    if (equation.contains(_batchSeparator)) {
+      return 'Equation cannot contain a NUL character';
     }
+    return null;
+  }
+
+  static String _errorJson(String message) {
+    return jsonEncode({'val': null, 'type': null, 'error': message});
+  }
+
+  /// Loads the module once, however many evaluations wait for it; a failed
+  /// load is tried again by the next evaluation.
+  Future<void> _ensureParsecInitialized() {
+    return _initialization ??=
+        _initializeParsec().catchError((Object error, StackTrace stackTrace) {
+      _initialization = null;
+      Error.throwWithStackTrace(error, stackTrace);
+    });
+  }
+
+  dynamic _handleEvaluationError(Object error) {
+    return parseNativeEvalResult(_errorJson(error.toString()));
   }
 
-  bool _isParseWebLibraryAvailable() {
+  Future<void> _initializeParsec() async {
+    final _LoadedModule loaded;
     try {
-      return js_util.hasProperty(web.window, 'Parsec');
-    } catch (e) {
-      return false;
+      final loader = await importModule(Uri.base.resolve(_loaderUrl).toString())
+          .toDart as _WasmLoader;
+      loaded = await loader.loadEquationsModule().toDart;
+    } catch (error) {
+      throw Exception('Failed to initialize Parsec WebAssembly module: $error\n'
+          'If the WASM files are missing during local development, run:\n'
+          '  dart run parsec_web:generate');
     }
+
+    final stopwatch = Stopwatch()..start();
+    loaded.module.evalBatchRaw('0$_batchSeparator');
+    final timings = loaded.timings;
+    _initTimings = {
+      'fetch': timings.fetch,
+      'compile': timings.compile,
+      'instantiate': timings.instantiate,
+      'firstEval': stopwatch.elapsedMicroseconds / 1000,
+      'cached': timings.cached,
+      'variant': timings.variant,
+    };
+    _module = loaded.module;
   }
+}
 
-  String _getLibraryNotFoundMessage() {
-    return '''
-ParsecWebError: parsec-web JavaScript wrapper not found!
+/// JavaScript interop definitions for `lib/js/parsec_wasm_loader.js` and the
+/// Emscripten module it loads.
+extension type _WasmLoader._(JSObject _) implements JSObject {
+  external JSPromise<_LoadedModule> loadEquationsModule();
+}
 
-To enable the Web platform, ensure your app's web/index.html includes:
-  <script type="module" src="packages/parsec_web/parsec-web/js/equations_parser_wrapper.js"></script>
-The wrapper dynamically imports the WASM glue at: ../wasm/equations_parser.js
+extension type _LoadedModule._(JSObject _) implements JSObject {
+  external _EquationsModule get module;
 
-If the WASM glue file is missing during local development, run:
-  ./setup_web_assets.sh
-This syncs the prebuilt WASM glue into the package at lib/parsec-web/wasm/.
-''';
-  }
+  external _LoadTimings get timings;
 }
 
-/// JavaScript interop definitions for the Parsec class
-/// 
-/// These bindings allow Dart to call the parsec-web JavaScript library
-/// that wraps the equations-parser WebAssembly module.
-@JS('Parsec')
-extension type ParsecJS._(JSObject _) implements JSObject {
-  external ParsecJS();
+extension type _LoadTimings._(JSObject _) implements JSObject {
+  external double get fetch;
 
-  external JSPromise<JSAny?> initialize(String wasmPath);
+  external double get compile;
 
-  external JSAny? eval(String equation);
+  external double get instantiate;
 
-  external String evalRaw(String equation);
+  external bool get cached;
 
-  external bool isReady();
+  external String get variant;
+}
 
-  external JSObject getSupportedFunctions();
+extension type _EquationsModule._(JSObject _) implements JSObject {
+  /// Evaluates a batch of equations, each followed by a NUL character, and
+  /// returns their raw JSON results in the same layout.
+  external String evalBatchRaw(String packed);
 }
@@ -0,0 +1,167 @@
+import 'dart:async';
+import 'dart:js_interop';
+import 'dart:js_interop_unsafe';
+import 'dart:math';
+
+import 'package:parsec_platform_interface/parsec_eval_exception.dart';
+import 'package:web/web.dart' as web;
+
+/// Web Workers each running their own instance of the equations-parser
+/// WebAssembly module, so evaluations do not block the main thread.
+///
+/// Each request goes to the worker with the fewest requests in flight,
+/// round-robin among equally loaded ones. A worker whose script failed is left
+/// out, and requests fail once every worker did. Results are the raw CalcJson
+/// strings `evalRaw` returns, so they parse exactly like main thread ones.
+class ParsecWebWorkerPool {
+  /// Starts [size] workers running the script at [scriptUrl].
+  ParsecWebWorkerPool(int size, {String scriptUrl = defaultScriptUrl})
+      : _workers = List.generate(size, (_) => _Worker(scriptUrl));
+
+  /// Worker script shipped in `lib/js` of this package.
+  static const defaultScriptUrl = 'packages/parsec_web/js/parsec_worker.js';
+
+  static const _separator = '\u0000';
+
+  final List<_Worker> _workers;
+  int _next = 0;
+
+  int get size => _workers.length;
+
+  /// Requests sent to the workers and not answered yet.
+  int get inFlight =>
+      _workers.fold(0, (total, worker) => total + worker.inFlight);
+
+  /// Evaluates [equations] on the workers and returns their CalcJson results
+  /// in input order, splitting them in up to [slices] requests evaluated by
+  /// different workers. The equations must not hold NUL characters, which
+  /// separate them in the requests.
+  Future<List<String>> evaluate(List<String> equations, {int slices = 1}) async {
+    if (equations.isEmpty) return [];
+    for (final equation in equations) {
+      if (equation.contains(_separator)) {
+        throw ArgumentError.value(
+            equation, 'equations', 'must not contain NUL characters');
+      }
+    }
+
+    slices = max(1, min(slices, min(size, equations.length)));
+    final sliceLength = (equations.length / slices).ceil();
+
+    final results = await Future.wait([
+      for (var start = 0; start < equations.length; start += sliceLength)
+        _evaluateSlice(equations.sublist(
+            start, min(start + sliceLength, equations.length))),
+    ]);
+    return [for (final slice in results) ...slice];
+  }
+
+  /// Waits for every worker to load its WebAssembly module.
+  Future<void> warmUp() async {
+    await Future.wait([for (final worker in _workers) worker.send('')]);
+  }
+
+  /// Terminates every worker once the requests in flight are answered.
+  void close() {
+    for (final worker in _workers) {
+      worker.close();
+    }
+  }
+
+  Future<List<String>> _evaluateSlice(List<String> equations) async {
+    final packed = equations.map((equation) => '$equation$_separator').join();
+    final results = await _leastLoaded().send(packed);
+    return results.split(_separator)..removeLast();
+  }
+
+  /// Returns the live worker with the fewest requests in flight, or the
+  /// first failed one, which rejects the request, if none is live.
+  _Worker _leastLoaded() {
+    _Worker? chosen;
+    for (var i = 0; i < _workers.length; i++) {
+      final worker = _workers[(_next + i) % _workers.length];
+      if (worker.failure != null) continue;
+      if (chosen == null || worker.inFlight < chosen.inFlight) chosen = worker;
+    }
+    _next = (_next + 1) % _workers.length;
+    return chosen ?? _workers.first;
+  }
+}
+
+class _Worker {
+  _Worker(String scriptUrl)
+      : _worker = web.Worker(scriptUrl, web.WorkerOptions(type: 'module')) {
+    _worker.onmessage = _onMessage.toJS;
+    _worker.onerror = _onError.toJS;
+  }
+
+  final web.Worker _worker;
+  final Map<int, Completer<String>> _pending = {};
+  int _nextId = 0;
+  bool _closing = false;
+
+  /// Why the worker script failed, after which the worker answers nothing.
+  String? failure;
+
+  int get inFlight => _pending.length;
+
+  Future<String> send(String packed) {
+    final failure = this.failure;
+    if (failure != null) return Future.error(ParsecEvalException(failure));
+
+    final id = _nextId++;
+    final completer = Completer<String>();
+    _pending[id] = completer;
+    _worker.postMessage(_Request(id: id, packed: packed));
+    return completer.future;
+  }
+
+  void close() {
+    _closing = true;
+    _terminateIfIdle();
+  }
+
+  void _onMessage(web.MessageEvent event) {
+    final reply = event.data as _Reply;
+    final completer = _pending.remove(reply.id);
+    if (completer != null) {
+      final error = reply.error;
+      if (error != null) {
+        completer.completeError(ParsecEvalException(error));
+      } else {
+        completer.complete(reply.packed!);
+      }
+    }
+    _terminateIfIdle();
+  }
+
+  /// The script failed to load or threw outside of a request: fails every
+  /// request in flight and every later one, as none of them will be
+  /// answered, and terminates the worker.
+  void _onError(web.Event event) {
+    // Failing to load a module script fires a plain Event, without a message
+    final message = event.has('message')
+        ? (event.getProperty('message'.toJS) as JSString).toDart
+        : 'Failed to load the Parsec worker';
+    failure = message;
+    for (final completer in _pending.values) {
+      completer.completeError(ParsecEvalException(message));
+    }
+    _pending.clear();
+    _worker.terminate();
+  }
+
+  void _terminateIfIdle() {
+    if (_closing && _pending.isEmpty) _worker.terminate();
+  }
+}
+
+extension type _Request._(JSObject _) implements JSObject {
+  external factory _Request({int id, String packed});
+}
+
+extension type _Reply._(JSObject _) implements JSObject {
+  external int get id;
+  external String? get packed;
+  external String? get error;
+}
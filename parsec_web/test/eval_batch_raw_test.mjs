@@ -0,0 +1,51 @@
+// Headless test of the evalBatchRaw export of each WebAssembly build:
+//   dart run parsec_web:generate && node --test test/
+import { existsSync } from 'node:fs';
+import { test } from 'node:test';
+import assert from 'node:assert/strict';
+
+const variants = { baseline: 'equations_parser', simd: 'equations_parser_simd', threads: 'equations_parser_threads' };
+
+async function load(variant) {
+  const { default: EquationsModule } = await import(glue(variant));
+  return EquationsModule();
+}
+
+function glue(variant) {
+  return new URL(`../lib/parsec-web/wasm/${variants[variant]}.js`, import.meta.url);
+}
+
+function evalBatch(module, equations) {
+  return module.evalBatchRaw(equations.map((equation) => equation + '\0').join(''))
+    .split('\0')
+    .slice(0, -1)
+    .map((json) => JSON.parse(json));
+}
+
+for (const variant of Object.keys(variants)) {
+  const skip = !existsSync(glue(variant)) && 'WASM glue not built';
+
+  test(`${variant}: evalBatchRaw evaluates a packed batch in one call`, { skip }, async () => {
+    const module = await load(variant);
+
+    const equations = ['2 + 3', '2 + )', 'sqrt(16)', 'concat("a", "b")'];
+    const results = evalBatch(module, equations);
+
+    assert.equal(results.length, equations.length);
+    assert.equal(Number(results[0].val), 5);
+    assert.equal(results[0].error, null);
+    assert.equal(results[1].val, null);
+    assert.ok(results[1].error);
+    assert.equal(Number(results[2].val), 4);
+    assert.deepEqual(results[3], { val: 'ab', type: 's', error: null });
+  });
+
+  test(`${variant}: large batches match the baseline build in input order`, { skip: skip || (!existsSync(glue('baseline')) && 'baseline not built') }, async () => {
+    const equations = Array.from({ length: 5000 }, (_, i) => (i % 7 === 0 ? `${i} + )` : `${i} * 2 + sin(${i})`));
+
+    const results = evalBatch(await load(variant), equations);
+
+    assert.deepEqual(results, evalBatch(await load('baseline'), equations));
+    assert.ok(Math.abs(Number(results[1].val) - (2 + Math.sin(1))) < 1e-9);
+  });
+}
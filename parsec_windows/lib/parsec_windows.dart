@@ -13,4 +13,11 @@ class ParsecWindows extends ParsecPlatform {
     return _channel.invokeMethod('nativeEval', {'equation': equation}).then(
         (result) => parseNativeEvalResult(result));
   }
+
+  @override
+  Future<List<dynamic>> nativeEvalBatch(List<String> equations) {
+    return _channel
+        .invokeListMethod<String>('nativeEvalBatch', {'equations': equations})
+        .then((results) => parseNativeEvalBatchResult(results ?? const []));
+  }
 }
@@ -87,11 +87,31 @@ void HandleNativeEval(const flutter::MethodCall<flutter::EncodableValue> &method
     result->Success(flutter::EncodableValue(ans_str));
 }
 
+void HandleNativeEvalBatch(const flutter::MethodCall<flutter::EncodableValue> &method_call,
+                           std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    const flutter::EncodableMap &arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
+    const flutter::EncodableList &equations = std::get<flutter::EncodableList>(arguments.at(flutter::EncodableValue("equations")));
+
+    flutter::EncodableList answers;
+    answers.reserve(equations.size());
+    for (const flutter::EncodableValue &equation : equations) {
+        mup::string_type mup_text_value = ConvertToWString(std::get<std::string>(equation));
+
+        mup::string_type ans = CalcJson(mup_text_value);
+
+        answers.push_back(flutter::EncodableValue(ConvertFromWString(ans)));
+    }
+
+    result->Success(flutter::EncodableValue(answers));
+}
+
 void ParsecWindowsPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue> &method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
   if (method_call.method_name().compare("nativeEval") == 0) {
     HandleNativeEval(method_call, std::move(result));
+  } else if (method_call.method_name().compare("nativeEvalBatch") == 0) {
+    HandleNativeEvalBatch(method_call, std::move(result));
   } else {
     result->NotImplemented();
   }